@@ -14,6 +14,10 @@ CFLAGS=
 LDFLAGS="-lz"
 GDB="false"
 CLEAN="false"
+THREADS=1
+SAVABLE="false"
+PERF="false"
+NATIVE_RAM="false"
 
 SCRIPT_DIR=$(dirname "$(readlink -f "$0")")
 BASH_PWD=$PWD
@@ -24,7 +28,7 @@ VSRC_FOLDER="vsrc"
 CSRC_FOLDER="csrc"
 BUILD_PATH=$PROJ_FOLDER/build
 
-while getopts 't:bsgca:f:l:v:' OPT; do
+while getopts 't:bsgca:f:l:v:j:SPN' OPT; do
     case $OPT in
         t)  V_TOP_FILE="$OPTARG";;
         b)  BUILD="true";;
@@ -35,6 +39,10 @@ while getopts 't:bsgca:f:l:v:' OPT; do
         f)  CFLAGS="$OPTARG";;
         l)  LDFLAGS="$OPTARG";;
         v)  VERILATORFLAGS="$OPTARG";;
+        j)  THREADS="$OPTARG";;
+        S)  SAVABLE="true";;
+        P)  PERF="true";;
+        N)  NATIVE_RAM="true";;
     esac
 done
 
@@ -72,8 +80,36 @@ build_proj() {
         CFLAGS="$CFLAGS -ggdb"
     fi
 
-    # compile
-    eval "verilator --x-assign unique --cc --exe --trace --assert -O3  -Wno-TIMESCALEMOD $VERILATORFLAGS -CFLAGS \"-std=c++11 -Wall $INCLUDE_CSRC_FOLDERS $CFLAGS\" -LDFLAGS $LDFLAGS -o $BUILD_PATH/$EMU_FILE \
+    # multithreaded model: v_rvcpu is verilated as its own hierarchical
+    # block so the scalar and vector domains become separate partitions,
+    # and DPI calls may run concurrently, so RAM uses per-word atomics
+    if [[ "$THREADS" -gt 1 ]]; then
+        VERILATORFLAGS="$VERILATORFLAGS --threads $THREADS --threads-dpi all --hierarchical"
+        CFLAGS="$CFLAGS -DRAM_POLICY=RAM_POLICY_ATOMIC"
+    fi
+    CFLAGS="$CFLAGS -DEMU_THREADS=$THREADS"
+
+    # savable model for checkpoint save/restore (main.cpp --ckpt-*)
+    if [[ "$SAVABLE" == "true" ]]; then
+        VERILATORFLAGS="$VERILATORFLAGS --savable"
+        CFLAGS="$CFLAGS -DEMU_SAVABLE"
+    fi
+
+    # TSC counters around eval, the DPI helpers, tracing and I/O (perf.h)
+    if [[ "$PERF" == "true" ]]; then
+        CFLAGS="$CFLAGS -DEMU_PERF"
+    fi
+
+    # RAM as a Verilog array in top.v instead of the DPI helpers in ram.v,
+    # loaded and saved through its public handle (csrc/ram/ram_native.h)
+    if [[ "$NATIVE_RAM" == "true" ]]; then
+        VERILATORFLAGS="$VERILATORFLAGS +define+EMU_NATIVE_RAM"
+        CFLAGS="$CFLAGS -DEMU_NATIVE_RAM"
+    fi
+
+    # compile; FST tracing runs on its own thread and is only switched on
+    # at run time (main.cpp --wave)
+    eval "verilator --x-assign unique --cc --exe --trace-fst --trace-threads 1 --assert -O3  -Wno-TIMESCALEMOD $VERILATORFLAGS -CFLAGS \"-std=c++11 -Wall $INCLUDE_CSRC_FOLDERS $CFLAGS\" -LDFLAGS $LDFLAGS -o $BUILD_PATH/$EMU_FILE \
         -Mdir $BUILD_PATH/emu-compile $INCLUDE_VSRC_FOLDERS --build $V_TOP_FILE $CSRC_FILES"
     if [ $? -ne 0 ]; then
         echo "Failed to run verilator!!!"
@@ -0,0 +1,147 @@
+// checkpoint.cpp
+// Checkpoint layout (one Verilator save stream):
+//   magic, main_time, cycles        3 x uint64_t
+//   Verilated model                 os << *top
+//   ROI word count, ROI words       uint64_t, see roi_save
+//   RAM page count                  uint64_t
+//   RAM page bitmap                 one byte per page, 1 = page stored
+//   RAM pages                       the non-zero 4KB pages, in order
+//   RAM dirty map                   one byte per page, see save_data
+// All-zero pages are skipped, so a checkpoint only grows with the part of
+// the 64MB RAM the image, the data and the program actually touched.
+//
+// A native-RAM build (build.sh -N) keeps the RAM in the model, which
+// os << *top already writes in full; its checkpoints leave out the bitmap
+// and the pages, and the restore copies the model RAM back to the host.
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Vtop.h"
+#include "ram.h"
+#include "roi.h"
+#include "ram_native.h"
+#include "checkpoint.h"
+
+#define CKPT_MAGIC      0x3254504b43554d45UL  // "EMUCKPT2"
+
+#ifdef EMU_SAVABLE
+#include <verilated_save.h>
+
+#ifndef EMU_NATIVE_RAM
+static bool page_is_zero(const uint64_t *page) {
+  for (uint64_t i = 0; i < EMU_PAGE_SIZE / sizeof(uint64_t); i++) {
+    if (page[i]) return false;
+  }
+  return true;
+}
+#endif
+
+bool ckpt_save(const char *path, Vtop *top, uint64_t main_time, uint64_t cycles) {
+  VerilatedSave os;
+  os.open(path);
+  if (!os.isOpen()) {
+    printf("Can not create checkpoint '%s'\n", path);
+    return false;
+  }
+  uint64_t magic = CKPT_MAGIC;
+  os << magic << main_time << cycles;
+  os << *top;
+
+  std::vector<uint64_t> roi;
+  roi_save(&roi);
+  uint64_t nr_roi = roi.size();
+  os << nr_roi;
+  os.write(roi.data(), nr_roi * sizeof(uint64_t));
+
+  uint64_t nr_pages = get_ram_size() / EMU_PAGE_SIZE;
+  os << nr_pages;
+#ifndef EMU_NATIVE_RAM
+  uint64_t nr_saved = 0;
+  uint8_t *ram = (uint8_t *)get_ram_start();
+  std::vector<uint8_t> present(nr_pages);
+  for (uint64_t i = 0; i < nr_pages; i++) {
+    present[i] = !page_is_zero((uint64_t *)(ram + i * EMU_PAGE_SIZE));
+  }
+  os.write(present.data(), nr_pages);
+  for (uint64_t i = 0; i < nr_pages; i++) {
+    if (present[i]) {
+      os.write(ram + i * EMU_PAGE_SIZE, EMU_PAGE_SIZE);
+      nr_saved++;
+    }
+  }
+#endif
+  os.write(get_ram_dirty_map(), nr_pages);
+  os.close();
+#ifndef EMU_NATIVE_RAM
+  printf("Checkpoint saved to %s at cycle %lu (%lu RAM pages)\n", path, cycles, nr_saved);
+#else
+  printf("Checkpoint saved to %s at cycle %lu (RAM inside the model)\n", path, cycles);
+#endif
+  return true;
+}
+
+bool ckpt_restore(const char *path, Vtop *top, uint64_t *main_time, uint64_t *cycles) {
+  VerilatedRestore is;
+  is.open(path);
+  if (!is.isOpen()) {
+    printf("Can not open checkpoint '%s'\n", path);
+    return false;
+  }
+  uint64_t magic = 0;
+  is >> magic;
+  if (magic != CKPT_MAGIC) {
+    printf("'%s' is not an emulator checkpoint\n", path);
+    return false;
+  }
+  is >> *main_time >> *cycles;
+  is >> *top;
+
+  uint64_t nr_roi = 0;
+  is >> nr_roi;
+  std::vector<uint64_t> roi(nr_roi);
+  is.read(roi.data(), nr_roi * sizeof(uint64_t));
+  if (!roi_restore(roi)) {
+    printf("Checkpoint '%s' has a bad region-of-interest state\n", path);
+    return false;
+  }
+
+  uint64_t nr_pages = 0;
+  is >> nr_pages;
+  if (nr_pages != get_ram_size() / EMU_PAGE_SIZE) {
+    printf("Checkpoint '%s' was taken with a different RAM size\n", path);
+    return false;
+  }
+#ifndef EMU_NATIVE_RAM
+  uint8_t *ram = (uint8_t *)get_ram_start();
+  std::vector<uint8_t> present(nr_pages);
+  is.read(present.data(), nr_pages);
+  for (uint64_t i = 0; i < nr_pages; i++) {
+    if (present[i]) {
+      is.read(ram + i * EMU_PAGE_SIZE, EMU_PAGE_SIZE);
+    } else {
+      memset(ram + i * EMU_PAGE_SIZE, 0, EMU_PAGE_SIZE);
+    }
+  }
+#endif
+  is.read(get_ram_dirty_map(), nr_pages);
+  // host RAM <- model RAM, so the save file sees the restored contents
+  native_ram_save(top);
+  is.close();
+  printf("Checkpoint restored from %s at cycle %lu\n", path, *cycles);
+  return true;
+}
+
+#else
+
+bool ckpt_save(const char *path, Vtop *top, uint64_t main_time, uint64_t cycles) {
+  printf("ERROR: checkpoints need a savable model, rebuild with ./hw/build.sh -b -S\n");
+  return false;
+}
+
+bool ckpt_restore(const char *path, Vtop *top, uint64_t *main_time, uint64_t *cycles) {
+  printf("ERROR: checkpoints need a savable model, rebuild with ./hw/build.sh -b -S\n");
+  return false;
+}
+
+#endif
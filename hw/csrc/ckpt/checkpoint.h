@@ -0,0 +1,15 @@
+#ifndef __CHECKPOINT_H
+#define __CHECKPOINT_H
+
+#include <cstdint>
+
+class Vtop;
+
+// Simulation checkpoints: the Verilated model state (needs a --savable
+// build, see build.sh -S), the emulated RAM and the simulation time.
+// Both functions return false if the checkpoint could not be written or
+// read.
+bool ckpt_save(const char *path, Vtop *top, uint64_t main_time, uint64_t cycles);
+bool ckpt_restore(const char *path, Vtop *top, uint64_t *main_time, uint64_t *cycles);
+
+#endif
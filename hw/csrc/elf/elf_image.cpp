@@ -0,0 +1,196 @@
+// elf_image.cpp
+// Minimal ELF64 reader for the program images built by the sw tree
+// (riscv64-mycpu, little-endian, statically linked).
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "elf_image.h"
+
+static std::vector<ElfSymbol> symbols;
+// file the symbols were read from, reloading the same image keeps them
+static std::string symbols_path;
+
+static bool symbol_less(const ElfSymbol &a, const ElfSymbol &b) {
+  return a.addr < b.addr || (a.addr == b.addr && a.size > b.size);
+}
+
+// map the whole file read-only, NULL on error
+static const uint8_t *map_elf(const char *path, size_t *size) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    printf("Can not open '%s'\n", path);
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Elf64_Ehdr)) {
+    close(fd);
+    return NULL;
+  }
+  void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    return NULL;
+  }
+  *size = st.st_size;
+  return (const uint8_t *)p;
+}
+
+static bool check_ehdr(const Elf64_Ehdr *eh, size_t size, const char *path) {
+  if (memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0 || eh->e_ident[EI_CLASS] != ELFCLASS64 ||
+      eh->e_ident[EI_DATA] != ELFDATA2LSB || eh->e_machine != EM_RISCV) {
+    printf("'%s' is not a RISC-V ELF64 little-endian image\n", path);
+    return false;
+  }
+  if (eh->e_shoff + (uint64_t)eh->e_shnum * sizeof(Elf64_Shdr) > size ||
+      eh->e_phoff + (uint64_t)eh->e_phnum * sizeof(Elf64_Phdr) > size) {
+    printf("'%s' is truncated\n", path);
+    return false;
+  }
+  return true;
+}
+
+static void read_symtab(const uint8_t *base, size_t size, const Elf64_Ehdr *eh) {
+  const Elf64_Shdr *sh = (const Elf64_Shdr *)(base + eh->e_shoff);
+  for (int i = 0; i < eh->e_shnum; i++) {
+    if (sh[i].sh_type != SHT_SYMTAB || sh[i].sh_link >= eh->e_shnum) continue;
+    const Elf64_Shdr &strtab = sh[sh[i].sh_link];
+    if (sh[i].sh_offset + sh[i].sh_size > size || strtab.sh_offset + strtab.sh_size > size) continue;
+    const Elf64_Sym *sym = (const Elf64_Sym *)(base + sh[i].sh_offset);
+    const char *str = (const char *)(base + strtab.sh_offset);
+    size_t nr_syms = sh[i].sh_size / sizeof(Elf64_Sym);
+    for (size_t j = 0; j < nr_syms; j++) {
+      int type = ELF64_ST_TYPE(sym[j].st_info);
+      if ((type != STT_FUNC && type != STT_OBJECT) || sym[j].st_shndx == SHN_UNDEF ||
+          sym[j].st_name >= strtab.sh_size) continue;
+      ElfSymbol s;
+      s.addr = sym[j].st_value;
+      s.size = sym[j].st_size;
+      s.func = (type == STT_FUNC);
+      s.name = str + sym[j].st_name;
+      symbols.push_back(s);
+    }
+  }
+  std::sort(symbols.begin(), symbols.end(), symbol_less);
+}
+
+bool elf_load_symbols(const char *path) {
+  symbols.clear();
+  symbols_path = path;
+  size_t size;
+  const uint8_t *base = map_elf(path, &size);
+  if (base == NULL) {
+    return false;
+  }
+  const Elf64_Ehdr *eh = (const Elf64_Ehdr *)base;
+  bool ok = check_ehdr(eh, size, path);
+  if (ok) {
+    read_symtab(base, size, eh);
+    printf("Loaded %lu symbols from %s\n", symbols.size(), path);
+  }
+  munmap((void *)base, size);
+  return ok;
+}
+
+bool elf_is_elf(const char *path) {
+  unsigned char ident[SELFMAG];
+  FILE *fp = fopen(path, "rb");
+  if (fp == NULL) {
+    return false;
+  }
+  bool is_elf = fread(ident, SELFMAG, 1, fp) == 1 && memcmp(ident, ELFMAG, SELFMAG) == 0;
+  fclose(fp);
+  return is_elf;
+}
+
+static uint64_t load_segments(const uint8_t *file, size_t file_size, const Elf64_Ehdr *eh,
+                              uint8_t *mem, uint64_t base, uint64_t size, const char *path) {
+  const Elf64_Phdr *ph = (const Elf64_Phdr *)(file + eh->e_phoff);
+  uint64_t end = 0;
+  for (int i = 0; i < eh->e_phnum; i++) {
+    if (ph[i].p_type != PT_LOAD || ph[i].p_memsz == 0) continue;
+    uint64_t addr = ph[i].p_paddr;
+    if (addr < base || addr - base > size || ph[i].p_memsz > size - (addr - base) ||
+        ph[i].p_filesz > ph[i].p_memsz || ph[i].p_offset + ph[i].p_filesz > file_size) {
+      printf("'%s': segment %d [0x%lx, 0x%lx) does not fit in [0x%lx, 0x%lx)\n", path, i,
+             addr, addr + ph[i].p_memsz, base, base + size);
+      return 0;
+    }
+    uint8_t *dst = mem + (addr - base);
+    memcpy(dst, file + ph[i].p_offset, ph[i].p_filesz);
+    memset(dst + ph[i].p_filesz, 0, ph[i].p_memsz - ph[i].p_filesz);
+    printf("  segment 0x%lx: 0x%lx bytes from file, 0x%lx zeroed\n", addr,
+           ph[i].p_filesz, ph[i].p_memsz - ph[i].p_filesz);
+    end = std::max(end, addr - base + ph[i].p_memsz);
+  }
+  return end;
+}
+
+uint64_t elf_load_image(const char *path, uint8_t *mem, uint64_t base, uint64_t size) {
+  size_t file_size;
+  const uint8_t *file = map_elf(path, &file_size);
+  if (file == NULL) {
+    return 0;
+  }
+  const Elf64_Ehdr *eh = (const Elf64_Ehdr *)file;
+  uint64_t end = 0;
+  if (check_ehdr(eh, file_size, path)) {
+    end = load_segments(file, file_size, eh, mem, base, size, path);
+    if (symbols_path != path) {
+      symbols.clear();
+      symbols_path = path;
+      read_symtab(file, file_size, eh);
+    }
+  }
+  munmap((void *)file, file_size);
+  return end;
+}
+
+size_t elf_nr_symbols() { return symbols.size(); }
+
+const ElfSymbol *elf_symbol(size_t i) { return i < symbols.size() ? &symbols[i] : NULL; }
+
+const ElfSymbol *elf_find_symbol(uint64_t addr) {
+  // last symbol starting at or below addr
+  size_t lo = 0, hi = symbols.size();
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (symbols[mid].addr <= addr) lo = mid + 1;
+    else hi = mid;
+  }
+  if (lo == 0) {
+    return NULL;
+  }
+  const ElfSymbol *s = &symbols[lo - 1];
+  if (s->size != 0) {
+    return addr < s->addr + s->size ? s : NULL;
+  }
+  return lo < symbols.size() || addr == s->addr ? s : NULL;
+}
+
+const ElfSymbol *elf_find_symbol(const char *name) {
+  for (size_t i = 0; i < symbols.size(); i++) {
+    if (symbols[i].name == name) return &symbols[i];
+  }
+  return NULL;
+}
+
+std::string elf_symbolize(uint64_t addr) {
+  char buf[64];
+  const ElfSymbol *s = elf_find_symbol(addr);
+  if (s == NULL) {
+    snprintf(buf, sizeof(buf), "0x%lx", addr);
+    return buf;
+  }
+  if (addr == s->addr) {
+    return s->name;
+  }
+  snprintf(buf, sizeof(buf), "+0x%lx", addr - s->addr);
+  return s->name + buf;
+}
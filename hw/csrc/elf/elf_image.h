@@ -0,0 +1,43 @@
+#ifndef __ELF_IMAGE_H
+#define __ELF_IMAGE_H
+
+#include <cstdint>
+#include <string>
+
+// Symbols of the program image, read from the .symtab of its ELF file.
+// Only function and data objects are kept, sorted by address.
+struct ElfSymbol {
+  uint64_t addr;
+  uint64_t size;
+  bool func;
+  std::string name;
+};
+
+// Read the symbol table of the ELF file at path. Returns false (and keeps
+// no symbols) if the file is missing or not a RISC-V ELF64 image.
+bool elf_load_symbols(const char *path);
+
+// True if the file at path starts with the ELF magic.
+bool elf_is_elf(const char *path);
+
+// Load the PT_LOAD segments of the ELF file at path into mem, which holds
+// [base, base + size) of the target physical address space: the file part
+// of each segment is copied and the rest (BSS) zeroed, so BSS takes no
+// space on disk. The symbol table is kept as with elf_load_symbols.
+// Returns the end of the highest segment relative to base, 0 on error.
+uint64_t elf_load_image(const char *path, uint8_t *mem, uint64_t base, uint64_t size);
+
+// Number of symbols loaded, and the i-th one in address order.
+size_t elf_nr_symbols();
+const ElfSymbol *elf_symbol(size_t i);
+
+// The function or object covering addr, NULL if none. Symbols without a
+// size (hand-written assembly) extend up to the next symbol.
+const ElfSymbol *elf_find_symbol(uint64_t addr);
+// Lookup by name, NULL if there is no such symbol.
+const ElfSymbol *elf_find_symbol(const char *name);
+
+// "name+0xoff" for addr, or the bare hex address if no symbol covers it
+std::string elf_symbolize(uint64_t addr);
+
+#endif
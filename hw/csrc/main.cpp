@@ -1,28 +1,97 @@
 
 //rvcpu-test.cpp
 #include <verilated.h>          
-#include <verilated_vcd_c.h>    
+#include <verilated_fst_c.h>
 #include <iostream>
 #include <fstream>
 #include <typeinfo>
 #include <iomanip>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <getopt.h>
+#include <sys/stat.h>
 #include "ram.h"
+#include "ram_native.h"
+#include "checkpoint.h"
+#include "perf.h"
+#include "elf_image.h"
+#include "profiler.h"
+#include "memtrace.h"
+#include "cache.h"
+#include "dram.h"
+#include "vstat.h"
+#include "roi.h"
+#include "sample.h"
+#include "vtrace.h"
 #include "Vtop.h"
 
 using namespace std;
 
-// #define DUMP_WAVE_ENABLE
 #define SAVE_DATA_ENABLE
 
 #define ADDR_BASE		0x80000000
 #define ADDR_INST		0x80000000
 #define ADDR_DATA		0x80800000
 
+// number of Verilator threads, set by build.sh -j
+#ifndef EMU_THREADS
+#define EMU_THREADS		1
+#endif
+
 static Vtop* top;
-static VerilatedVcdC* tfp;
+static VerilatedFstC* tfp = NULL;
 static vluint64_t main_time = 0;
+static vluint64_t cycles = 0;
 // static const vluint64_t sim_time = 100000000;
 
+// checkpoint options
+static const char *ckpt_save_path = NULL;
+static const char *ckpt_restore_path = NULL;
+static bool ckpt_at_cycle = false;
+static vluint64_t ckpt_cycle = 0;
+static bool ckpt_at_pc = false;
+static vluint64_t ckpt_pc = 0;
+
+// batch mode: list of data images to run one after another
+static const char *batch_list = NULL;
+
+// Hang watchdog: the run is stopped when, for watchdog_cycles cycles, the
+// committed pc stays within a WATCHDOG_SPAN byte window and nothing is
+// written to RAM. 0 disables it.
+#define WATCHDOG_SPAN	256
+#define EXIT_HANG		3
+static vluint64_t watchdog_cycles = 10000000;
+static vluint64_t wd_start, wd_lo, wd_hi, wd_writes;
+
+// ELF file with the symbols of the program, by default <inst>.elf next
+// to <inst>.bin, and the per-function profile output
+static const char *elf_path = NULL;
+static const char *profile_path = NULL;
+
+// Waveform window: an FST trace (written by Verilator's trace thread) that
+// starts and stops on a cycle number, when the core reaches a pc (address
+// or symbol), or on a marker instruction `addi x0, x0, ID`, a hint that
+// every RISC-V core executes as a nop, or with the --roi region (roi.h).
+// The trace is cut off once the file grows past wave_limit_mb.
+enum { WAVE_AT_NONE, WAVE_AT_CYCLE, WAVE_AT_PC, WAVE_AT_MARKER, WAVE_AT_ROI };
+struct WaveTrigger {
+	int kind;
+	vluint64_t value;
+	const char *symbol;		// pc given by name, resolved once symbols are loaded
+};
+static const char *wave_path = NULL;
+static WaveTrigger wave_start = { WAVE_AT_NONE, 0, NULL };
+static WaveTrigger wave_stop = { WAVE_AT_NONE, 0, NULL };
+static vluint64_t wave_limit_mb = 2048;
+static bool wave_done = false;
+
+// memory access trace output (memtrace.h)
+static const char *memtrace_path = NULL;
+
+// vector instruction trace output, replayed by hw/vtb (vtrace.h)
+static const char *vtrace_path = NULL;
+
 const char* get_color_code(const char* color_name) {
     if (strcmp(color_name, "red") == 0 || strcmp(color_name, "r") == 0) return "31"; 
     if (strcmp(color_name, "green") == 0 || strcmp(color_name, "g") == 0) return "32"; 
@@ -43,6 +112,343 @@ void color_printf(const char* color_name, const char* format, ...) {
     printf("\033[0m");
 }
 
+// One clock cycle: falling edge at main_time, rising edge half a cycle
+// later. Only the two edges are evaluated; half_cycle just spaces out the
+// trace timestamps the same way the old tick-by-tick loop did.
+static inline void sim_cycle(int half_cycle) {
+	top->clock = 0;
+	memtrace_posedge = false;
+	{ PerfScope perf(PERF_EVAL); top->eval(); }
+	if ( tfp ) { PerfScope perf(PERF_TRACE); tfp->dump(main_time); }
+	top->clock = 1;
+	memtrace_posedge = true;
+	if ( !top->mem_stall ) cache_next_inst();
+	{ PerfScope perf(PERF_EVAL); top->eval(); }
+	if ( tfp ) { PerfScope perf(PERF_TRACE); tfp->dump(main_time + half_cycle); }
+	main_time += half_cycle*2;
+	cycles++;
+}
+
+static void watchdog_reset() {
+	wd_start = cycles;
+	wd_lo = wd_hi = top->debug_pc;
+	wd_writes = native_ram_write_count(top);
+}
+
+// called once per cycle, returns true when the core looks stuck
+static inline bool watchdog_hung() {
+	if ( watchdog_cycles == 0 ) return false;
+	vluint64_t pc = top->debug_pc;
+	if ( pc < wd_lo ) wd_lo = pc;
+	if ( pc > wd_hi ) wd_hi = pc;
+	if ( wd_hi - wd_lo >= WATCHDOG_SPAN || native_ram_write_count(top) != wd_writes ) {
+		watchdog_reset();
+		return false;
+	}
+	return cycles - wd_start >= watchdog_cycles;
+}
+
+static void watchdog_report() {
+	color_printf( "red", "HANG: no progress for %lu cycles, pc stuck in [0x%lx, 0x%lx] (pc = 0x%lx, inst = 0x%08x), no RAM writes since cycle %lu\n",
+		cycles - wd_start, wd_lo, wd_hi, (vluint64_t)top->debug_pc, (uint32_t)top->debug_inst, wd_start );
+}
+
+// SPEC is CYCLE, pc:ADDR, pc:SYMBOL, marker:ID or roi
+static WaveTrigger parse_wave_trigger(const char *spec) {
+	WaveTrigger t = { WAVE_AT_NONE, 0, NULL };
+	char *end;
+	if ( strcmp(spec, "roi") == 0 ) {
+		t.kind = WAVE_AT_ROI;
+	} else if ( strncmp(spec, "pc:", 3) == 0 ) {
+		t.kind = WAVE_AT_PC;
+		t.value = strtoull(spec + 3, &end, 0);
+		if ( *end != '\0' || end == spec + 3 ) t.symbol = spec + 3;
+	} else if ( strncmp(spec, "marker:", 7) == 0 ) {
+		vluint64_t id = strtoull(spec + 7, &end, 0);
+		if ( *end != '\0' || id == 0 || id > 0x7ff ) {
+			printf("\033[31mERROR: marker id must be 1..2047: %s\033[0m\n", spec);
+			exit(1);
+		}
+		t.kind = WAVE_AT_MARKER;
+		t.value = (id << 20) | 0x13;
+	} else {
+		t.kind = WAVE_AT_CYCLE;
+		t.value = strtoull(spec, &end, 0);
+		if ( *end != '\0' ) {
+			printf("\033[31mERROR: bad trigger '%s', expected CYCLE, pc:ADDR|SYMBOL, marker:ID or roi\033[0m\n", spec);
+			exit(1);
+		}
+	}
+	return t;
+}
+
+static void resolve_wave_trigger(WaveTrigger *t) {
+	if ( t->symbol == NULL ) return;
+	const ElfSymbol *sym = elf_find_symbol(t->symbol);
+	if ( sym == NULL ) {
+		printf("\033[31mERROR: unknown symbol '%s'\033[0m\n", t->symbol);
+		exit(1);
+	}
+	t->value = sym->addr;
+}
+
+static inline bool wave_hit(const WaveTrigger &t) {
+	switch ( t.kind ) {
+		case WAVE_AT_CYCLE : return cycles >= t.value;
+		case WAVE_AT_PC    : return top->debug_pc == t.value;
+		case WAVE_AT_MARKER: return top->debug_inst == t.value;
+		case WAVE_AT_ROI   : return roi_active;
+	}
+	return false;
+}
+
+static void wave_open() {
+	tfp = new VerilatedFstC;
+	top->trace(tfp, 99);
+	tfp->open(wave_path);
+	printf("\033[34mWaveform: tracing to %s from cycle %lu\033[0m\n", wave_path, cycles);
+}
+
+static void wave_close(const char *why) {
+	if ( tfp == NULL ) return;
+	tfp->close();
+	delete tfp;
+	tfp = NULL;
+	wave_done = true;
+	printf("\033[34mWaveform: stopped at cycle %lu (%s)\033[0m\n", cycles, why);
+}
+
+// called before every cycle while the waveform window is not over
+static void wave_update() {
+	if ( tfp == NULL ) {
+		if ( wave_hit(wave_start) ) wave_open();
+		return;
+	}
+	// a roi stop trigger fires when the region closes
+	if ( wave_stop.kind == WAVE_AT_ROI ? !roi_active : wave_hit(wave_stop) ) {
+		wave_close("stop trigger");
+	} else if ( (cycles & 0xffff) == 0 ) {
+		struct stat st;
+		if ( stat(wave_path, &st) == 0 && (vluint64_t)st.st_size >= (wave_limit_mb << 20) ) {
+			wave_close("size limit");
+		}
+	}
+}
+
+// Drive mem_stall from the cache model: cycles with pending miss latency
+// run with the core stalled. When a stall ends, the held instruction is
+// evaluated once more so its data accesses, which may miss in turn, are
+// seen before it commits.
+static inline void update_stall() {
+	bool stall = ram_stall_pending();
+	if ( !stall && top->mem_stall ) {
+		top->mem_stall = 0;
+		{ PerfScope perf(PERF_EVAL); top->eval(); }
+		stall = ram_stall_pending();
+	}
+	if ( stall != (bool)top->mem_stall ) {
+		top->mem_stall = stall;
+		{ PerfScope perf(PERF_EVAL); top->eval(); }
+	}
+}
+
+// hold reset for one cycle
+static void reset_core(int half_cycle) {
+	top->reset = 1;
+	sim_cycle(half_cycle);
+	top->reset = 0;
+}
+
+// Run every data image listed in batch_list (one per line, optionally
+// followed by its save file, otherwise <path_save>.<n>). The model and the
+// instruction image are set up once; each image gets a fresh RAM, its own
+// data window at ADDR_DATA and a core reset. Returns the exit code: 0 when
+// every image finished, EXIT_HANG if any hung, otherwise 1 on timeouts.
+static int run_batch(const char *path_save, vluint64_t max_cycles, int half_cycle) {
+	ifstream list(batch_list);
+	if ( !list ) {
+		printf("\033[31mERROR: Can not open batch list %s\033[0m\n", batch_list);
+		exit(1);
+	}
+	int nr_images = 0, nr_timeout = 0, nr_hung = 0;
+	vluint64_t total_cycles = 0;
+	string line;
+	auto batch_start = std::chrono::steady_clock::now();
+	while ( getline(list, line) ) {
+		istringstream fields(line);
+		string data_img, save_img;
+		if ( !(fields >> data_img) || data_img[0] == '#' ) continue;
+		if ( !(fields >> save_img) ) save_img = string(path_save) + "." + to_string(nr_images);
+
+		{
+			PerfScope perf(PERF_IO);
+			ram_reset();
+			load_data(ADDR_DATA, data_img.c_str());
+			native_ram_load(top);
+		}
+		Verilated::gotFinish(false);
+		cycles = 0;
+		printf("\033[34m[%d] %s\033[0m\n", nr_images, data_img.c_str());
+		cache_reset();
+		reset_core(half_cycle);
+		roi_reset();
+		watchdog_reset();
+		bool hung = false;
+		while( !Verilated::gotFinish() && cycles < max_cycles && !hung ){
+			if ( cache_on ) {
+				update_stall();
+				cache_tick(cycles, top->debug_pc);
+			}
+			roi_tick(cycles, top->debug_inst, top->mem_stall);
+			if ( vstat_on && roi_active && !top->mem_stall ) vstat_tick(top->debug_inst);
+			sim_cycle(half_cycle);
+			hung = watchdog_hung();
+		}
+		printf("\n\033[34m[%d] finished after \033[35m%ld\033[34m cycles.\033[0m\n", nr_images, cycles);
+		if ( hung ) {
+			watchdog_report();
+			nr_hung++;
+		} else if ( !Verilated::gotFinish() ) {
+			color_printf( "red", "[%d] timed out !!!\n", nr_images );
+			nr_timeout++;
+		}
+#ifdef SAVE_DATA_ENABLE
+		{ PerfScope perf(PERF_IO); native_ram_save(top); save_data( ADDR_DATA, save_img.c_str() ); }
+#endif
+		total_cycles += cycles;
+		nr_images++;
+	}
+	double batch_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batch_start).count();
+	printf("----------------------------------------------------------\n");
+	printf("\033[34mBatch: \033[35m%d\033[34m image(s), \033[35m%d\033[34m timed out, \033[35m%d\033[34m hung, \033[35m%ld\033[34m cycles in %.3f s (%.1f images/s)\033[0m\n",
+		nr_images, nr_timeout, nr_hung, total_cycles, batch_seconds, nr_images / batch_seconds);
+	cache_report(total_cycles);
+	roi_report(total_cycles);
+	vstat_report();
+	perf_report(total_cycles);
+	return nr_hung ? EXIT_HANG : nr_timeout ? 1 : 0;
+}
+
+static void print_usage(const char *prog) {
+	printf("Usage: %s [options] <inst.bin|inst.elf> <data.bin> <save.bin> <sim_time> <half_cycle>\n", prog);
+	printf("Options:\n");
+	printf("  --ckpt-save=FILE      save a checkpoint to FILE (needs build.sh -S)\n");
+	printf("  --ckpt-cycle=N        ... when cycle N is reached\n");
+	printf("  --ckpt-pc=ADDR        ... when the core reaches pc ADDR\n");
+	printf("  --ckpt-restore=FILE   resume from the checkpoint in FILE\n");
+	printf("  --save-window=ADDR:LEN  only save [ADDR, ADDR+LEN) (repeatable)\n");
+	printf("  --save-flat           save a flat dump from ADDR_DATA to the end of RAM\n");
+	printf("  --watchdog=N          stop a run that makes no progress for N cycles\n");
+	printf("                        with exit code %d (default %lu, 0 = off)\n", EXIT_HANG, watchdog_cycles);
+	printf("  --profile=FILE        write a per-function cycle profile to FILE\n");
+	printf("  --elf=FILE            symbols for the profile (default: <inst.bin> as .elf)\n");
+	printf("  --wave=FILE           write an FST waveform to FILE\n");
+	printf("  --wave-start=SPEC     start tracing at SPEC: CYCLE, pc:ADDR, pc:SYMBOL or\n");
+	printf("                        marker:ID (addi x0, x0, ID) or roi, default: from reset\n");
+	printf("  --wave-stop=SPEC      stop tracing at SPEC, default: end of simulation\n");
+	printf("  --wave-limit=MB       stop tracing when the file reaches MB (default %lu)\n", wave_limit_mb);
+	printf("  --mem-trace=FILE      write a compressed trace of all data accesses to FILE\n");
+	printf("  --vec-trace=FILE      record the vector instruction stream for hw/vtb to FILE\n");
+	printf("  --icache=SPEC         I-cache model, SPEC is SIZE,WAYS,LINE[,lru|fifo|random]\n");
+	printf("  --dcache=SPEC         D-cache model (scalar and vector data), same SPEC\n");
+	printf("  --miss-latency=N      stall the core N cycles per cache miss (default 0)\n");
+	printf("  --dram=SPEC           DRAM timing behind the caches, SPEC is\n");
+	printf("                        LAT,BW[,BANKS,ROW,ROW_MISS] (see dram.h)\n");
+	printf("  --roi=ID|all          collect --profile, --vec-stats, --mem-trace and --wave only\n");
+	printf("                        inside ROI_BEGIN(ID)/ROI_END(ID), or inside any region\n");
+	printf("  --vec-stats           report the vector instruction mix and lane utilization\n");
+	printf("  --sample=P,W,M        interval sampling: of every P instructions run W warm-up and\n");
+	printf("                        M measured ones with the cache/DRAM models, fast-forward the\n");
+	printf("                        rest without them, and estimate the total cycles (sample.h)\n");
+	printf("  --batch=LIST          run every data image listed in LIST (\"data.bin [save.bin]\"\n");
+	printf("                        per line) instead of <data.bin>, saving to <save.bin>.<n>\n");
+}
+
+// parse the options, leaving optind at the first positional argument
+static void parse_args(int argc, char **argv) {
+	static const struct option long_options[] = {
+		{ "ckpt-save",    required_argument, NULL, 's' },
+		{ "ckpt-cycle",   required_argument, NULL, 'c' },
+		{ "ckpt-pc",      required_argument, NULL, 'p' },
+		{ "ckpt-restore", required_argument, NULL, 'r' },
+		{ "save-window",  required_argument, NULL, 'w' },
+		{ "save-flat",    no_argument,       NULL, 'F' },
+		{ "batch",        required_argument, NULL, 'b' },
+		{ "watchdog",     required_argument, NULL, 'W' },
+		{ "profile",      required_argument, NULL, 'P' },
+		{ "elf",          required_argument, NULL, 'e' },
+		{ "wave",         required_argument, NULL, 'v' },
+		{ "wave-start",   required_argument, NULL, '[' },
+		{ "wave-stop",    required_argument, NULL, ']' },
+		{ "wave-limit",   required_argument, NULL, 'L' },
+		{ "mem-trace",    required_argument, NULL, 'm' },
+		{ "vec-trace",    required_argument, NULL, 'T' },
+		{ "icache",       required_argument, NULL, 'I' },
+		{ "dcache",       required_argument, NULL, 'D' },
+		{ "miss-latency", required_argument, NULL, 'M' },
+		{ "dram",         required_argument, NULL, 'R' },
+		{ "vec-stats",    no_argument,       NULL, 'V' },
+		{ "roi",          required_argument, NULL, 'O' },
+		{ "sample",       required_argument, NULL, 'S' },
+		{ "help",         no_argument,       NULL, 'h' },
+		{ 0,              0,                 NULL,  0  }
+	};
+	int o;
+	while ( (o = getopt_long(argc, argv, "h", long_options, NULL)) != -1 ) {
+		switch (o) {
+			case 's': ckpt_save_path = optarg; break;
+			case 'c': ckpt_at_cycle = true; ckpt_cycle = strtoull(optarg, NULL, 0); break;
+			case 'p': ckpt_at_pc = true; ckpt_pc = strtoull(optarg, NULL, 0); break;
+			case 'r': ckpt_restore_path = optarg; break;
+			case 'w': {
+				char *end;
+				vluint64_t addr = strtoull(optarg, &end, 0);
+				if ( *end != ':' ) {
+					printf("\033[31mERROR: --save-window expects ADDR:LEN\033[0m\n");
+					exit(1);
+				}
+				ram_add_save_window(addr, strtoull(end + 1, NULL, 0));
+				break;
+			}
+			case 'F': ram_save_flat(true); break;
+			case 'b': batch_list = optarg; break;
+			case 'W': watchdog_cycles = strtoull(optarg, NULL, 0); break;
+			case 'P': profile_path = optarg; break;
+			case 'e': elf_path = optarg; break;
+			case 'v': wave_path = optarg; break;
+			case '[': wave_start = parse_wave_trigger(optarg); break;
+			case ']': wave_stop = parse_wave_trigger(optarg); break;
+			case 'L': wave_limit_mb = strtoull(optarg, NULL, 0); break;
+			case 'm': memtrace_path = optarg; break;
+			case 'T': vtrace_path = optarg; break;
+			case 'I': if ( !cache_config_icache(optarg) ) exit(1); break;
+			case 'D': if ( !cache_config_dcache(optarg) ) exit(1); break;
+			case 'M': cache_set_miss_latency(strtoull(optarg, NULL, 0)); break;
+			case 'R': if ( !dram_config(optarg) ) exit(1); break;
+			case 'V': vstat_on = true; break;
+			case 'O': if ( !roi_select(optarg) ) exit(1); break;
+			case 'S': if ( !sample_config(optarg) ) exit(1); break;
+			case 'h': print_usage(argv[0]); exit(0);
+			default : print_usage(argv[0]); exit(1);
+		}
+	}
+	// with a region selected the waveform covers its first instance
+	if ( roi_selected() && wave_start.kind == WAVE_AT_NONE ) wave_start.kind = WAVE_AT_ROI;
+	if ( roi_selected() && wave_stop.kind == WAVE_AT_NONE ) wave_stop.kind = WAVE_AT_ROI;
+	if ( ckpt_save_path != NULL && !ckpt_at_cycle && !ckpt_at_pc ) {
+		printf("\033[31mERROR: --ckpt-save needs --ckpt-cycle or --ckpt-pc\033[0m\n");
+		exit(1);
+	}
+	if ( batch_list != NULL && (ckpt_save_path != NULL || ckpt_restore_path != NULL) ) {
+		printf("\033[31mERROR: checkpoints are not supported in batch mode\033[0m\n");
+		exit(1);
+	}
+	if ( batch_list != NULL && (profile_path != NULL || wave_path != NULL || memtrace_path != NULL || vtrace_path != NULL || sample_on) ) {
+		printf("\033[31mERROR: --profile, --wave, --mem-trace, --vec-trace and --sample are not supported in batch mode\033[0m\n");
+		exit(1);
+	}
+}
+
 int main(int argc, char **argv)
 {
 	char default_path_inst[] = "../../data/bin/hello-str-riscv64-mycpu.bin" ;
@@ -54,6 +460,9 @@ int main(int argc, char **argv)
 	char *path_save ;
 	vluint64_t sim_time ;
 	int half_cycle ;
+	parse_args(argc, argv);
+	argc -= optind - 1;
+	argv += optind - 1;
 	if (argc != 6){
 		printf("\033[31mERROR: No binary file\033[0m\n");
 		path_inst = default_path_inst ;
@@ -68,60 +477,156 @@ int main(int argc, char **argv)
 		sim_time = std::stoull(argv[4]);
 		half_cycle = std::stoull(argv[5]);
 	}
-	color_printf( "red", "Max-Run-Cycles = %d\n", sim_time/(half_cycle*2) );
+	vluint64_t max_cycles = sim_time/(half_cycle*2);
+	color_printf( "red", "Max-Run-Cycles = %lu\n", max_cycles );
 
+	perf_start();
 	printf("Initialing RAM ...\n");
-    init_ram(path_inst);
+	{ PerfScope perf(PERF_IO); init_ram(path_inst); }
 	printf("\033[32mInitial RAM done !!!\033[0m\n");
 
-	printf("Initialing Data ...\n");
-	load_data(ADDR_DATA, path_data );
-	printf("\033[32mLoad Data done !!!\033[0m\n");
+	if ( batch_list == NULL ) {
+		printf("Initialing Data ...\n");
+		{ PerfScope perf(PERF_IO); load_data(ADDR_DATA, path_data ); }
+		printf("\033[32mLoad Data done !!!\033[0m\n");
+	}
+
+	cache_init();
+	// without a memory model every instruction takes one cycle
+	if ( sample_on && !cache_on ) {
+		printf("\033[31mERROR: --sample needs a timing model (--icache, --dcache or --dram)\033[0m\n");
+		exit(1);
+	}
+#ifdef EMU_NATIVE_RAM
+	// the native RAM never calls the DPI helpers these hook into
+	if ( cache_on || memtrace_path != NULL || vtrace_path != NULL ) {
+		printf("\033[31mERROR: the cache model, --mem-trace and --vec-trace need the DPI RAM, rebuild without -N\033[0m\n");
+		exit(1);
+	}
+#endif
+#if EMU_THREADS > 1
+	// the trace buffer is filled from the DPI helpers without a lock
+	if ( memtrace_path != NULL ) {
+		printf("\033[31mERROR: --mem-trace needs a single-threaded build, rebuild with -j 1\033[0m\n");
+		exit(1);
+	}
+	// so is the cache/DRAM state, --sample runs on top of it
+	if ( cache_on ) {
+		printf("\033[31mERROR: --icache, --dcache, --dram and --sample need a single-threaded build, rebuild with -j 1\033[0m\n");
+		exit(1);
+	}
+#endif
+
+	// an ELF instruction image already brought its symbols along
+	bool need_symbols = profile_path != NULL || cache_on || wave_start.symbol != NULL || wave_stop.symbol != NULL;
+	if ( need_symbols && ( elf_path != NULL || elf_nr_symbols() == 0 ) ) {
+		string elf = ( elf_path != NULL ) ? elf_path : string(path_inst);
+		if ( elf_path == NULL && elf.size() > 4 && elf.compare(elf.size() - 4, 4, ".bin") == 0 ) {
+			elf.replace(elf.size() - 4, 4, ".elf");
+		}
+		if ( !elf_load_symbols(elf.c_str()) ) {
+			printf("\033[33mWARNING: no symbols from %s, only addresses can be used\033[0m\n", elf.c_str());
+		}
+	}
+	resolve_wave_trigger(&wave_start);
+	resolve_wave_trigger(&wave_stop);
+	if ( profile_path != NULL ) {
+		profiler_init();
+	}
 
   	// Verilated::commandArgs(argc, argv);
 	top = new Vtop;
+	top->mem_stall = 0;
+	{ PerfScope perf(PERF_IO); native_ram_load(top); }
 
-#ifdef DUMP_WAVE_ENABLE
-	Verilated::traceEverOn(true);
-  	tfp = new VerilatedVcdC;
-	top->trace(tfp, 0);
-  	tfp->open("top.vcd");
-#endif
+	if ( memtrace_path != NULL && !memtrace_open(memtrace_path) ) {
+		exit(1);
+	}
+	memtrace_pause(!roi_active);
+	if ( vtrace_path != NULL && !vtrace_open(vtrace_path) ) {
+		exit(1);
+	}
+	if ( wave_path != NULL ) {
+		Verilated::traceEverOn(true);
+		if ( wave_start.kind == WAVE_AT_NONE ) wave_open();
+	}
 
 	printf("\033[34mThe program is running now......\033[0m\n");
 	printf("----------------------------------------------------------\n");
-	while( !Verilated::gotFinish() && main_time < sim_time ){
-		if( main_time % (half_cycle*2) == 0 ) top->clock = 0;
-		if( main_time % (half_cycle*2) == half_cycle ) top->clock = 1;
-		if( main_time < (half_cycle*2) ) {
-			top->reset = 1;
-		} else {
-			top->reset = 0;
+	if ( batch_list != NULL ) {
+		int exit_code = run_batch(path_save, max_cycles, half_cycle);
+		delete top;
+		ram_finish();
+		exit(exit_code);
+	}
+	auto sim_start = std::chrono::steady_clock::now();
+	if ( ckpt_restore_path != NULL ) {
+		PerfScope perf(PERF_IO);
+		if ( !ckpt_restore(ckpt_restore_path, top, &main_time, &cycles) ) exit(1);
+		top->reset = 0;
+		// a region may have begun before the checkpoint
+		memtrace_pause(!roi_active);
+	} else {
+		// reset is held for the first cycle only
+		reset_core(half_cycle);
+	}
+	bool ckpt_pending = ( ckpt_save_path != NULL );
+	bool hung = false;
+	watchdog_reset();
+	while( !Verilated::gotFinish() && cycles < max_cycles && !hung ){
+		if ( cache_on ) {
+			update_stall();
+			cache_tick(cycles, top->debug_pc);
+		}
+		// fast-forward windows run without the memory models
+		if ( sample_on ) cache_on = sample_tick(cycles, top->mem_stall);
+		// the pc/inst seen before the edge is what the core commits on it
+		if ( roi_tick(cycles, top->debug_inst, top->mem_stall) ) memtrace_pause(!roi_active);
+		if ( profile_path != NULL && roi_active ) profiler_tick(cycles, top->debug_pc, top->debug_inst);
+		if ( vstat_on && roi_active && !top->mem_stall ) vstat_tick(top->debug_inst);
+		if ( wave_path != NULL && !wave_done ) wave_update();
+		if ( memtrace_on && !top->mem_stall ) memtrace_tick(cycles, top->debug_pc, top->debug_inst);
+		if ( vtrace_on && !top->mem_stall ) vtrace_tick(top->debug_inst, top->debug_vec_rs1);
+		sim_cycle(half_cycle);
+		hung = watchdog_hung();
+		if ( ckpt_pending && ( (ckpt_at_cycle && cycles == ckpt_cycle) || (ckpt_at_pc && top->debug_pc == ckpt_pc) ) ) {
+			PerfScope perf(PERF_IO);
+			native_ram_save(top);
+			ckpt_save(ckpt_save_path, top, main_time, cycles);
+			ckpt_pending = false;
 		}
-		top->eval();
-	#ifdef DUMP_WAVE_ENABLE
-		tfp->dump(main_time);
-	#endif 
-		main_time++;
 	}
+	double sim_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - sim_start).count();
 	std::cout << std::endl;
 	printf("----------------------------------------------------------\n");
-	printf("\033[34mThe program finished after \033[35m%ld\033[34m cycles.\033[0m \n", main_time/(half_cycle*2));
-	if( main_time >= sim_time ) {
+	printf("\033[34mThe program finished after \033[35m%ld\033[34m cycles.\033[0m \n", cycles);
+	if ( hung ) {
+		watchdog_report();
+	} else if( !Verilated::gotFinish() ) {
 		color_printf( "red", "The sim time is too short !!!\nYOU MUST MODIFY THE VARIABLE sim_time in ./hw/csrc/main.cpp !!!\n" ) ;
 	}
+	if ( profile_path != NULL ) {
+		profiler_finish(cycles, profile_path);
+	}
+	cache_on |= sample_on;
+	cache_report(cycles);
+	sample_report(cycles);
+	roi_report(cycles);
+	vstat_report();
+	printf("\033[34mSimulation speed: \033[35m%.0f\033[34m cycles/s (%.3f s, %d thread(s))\033[0m\n",
+		cycles / sim_seconds, sim_seconds, EMU_THREADS);
 
 #ifdef SAVE_DATA_ENABLE
 	printf( "Save the data into file %s\n", path_save );
-	save_data( ADDR_DATA, path_save);
+	{ PerfScope perf(PERF_IO); native_ram_save(top); save_data( ADDR_DATA, path_save); }
 #endif
+	perf_report(cycles);
 
-#ifdef DUMP_WAVE_ENABLE
-	tfp->close();
-	delete tfp;
-#endif 
+	wave_close("end of simulation");
+	memtrace_close();
+	vtrace_close();
 	delete top;
 	ram_finish();
-	exit(0);
+	exit(hung ? EXIT_HANG : 0);
 	return 0;
 }
@@ -0,0 +1,149 @@
+// memtrace.cpp
+#include <zlib.h>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "memtrace.h"
+
+// records per buffer handed to the writer thread, and how many full
+// buffers may queue up before the simulation waits for the writer
+#define MEMTRACE_BUF_RECORDS  (1 << 16)
+#define MEMTRACE_MAX_QUEUED   8
+
+bool memtrace_on = false;
+bool memtrace_posedge = false;
+
+static gzFile trace_file;
+static bool trace_open = false;
+static std::vector<MemTraceRecord> *cur_buf;
+static std::deque< std::vector<MemTraceRecord> * > full_bufs;
+static std::mutex queue_lock;
+static std::condition_variable queue_cv;
+static std::thread writer;
+static bool writer_exit = false;
+static uint64_t nr_records = 0;
+
+// context of the instruction committed in the current cycle
+static uint64_t cur_cycle, cur_pc;
+static uint32_t cur_inst;
+// reads made for the next instruction, emitted once it commits
+static bool pending_read[2];
+static uint64_t pending_idx[2];
+
+static void writer_main() {
+  std::unique_lock<std::mutex> lock(queue_lock);
+  while (true) {
+    queue_cv.wait(lock, [] { return writer_exit || !full_bufs.empty(); });
+    if (full_bufs.empty()) break;
+    std::vector<MemTraceRecord> *buf = full_bufs.front();
+    full_bufs.pop_front();
+    queue_cv.notify_all();
+    lock.unlock();
+    gzwrite(trace_file, buf->data(), buf->size() * sizeof(MemTraceRecord));
+    delete buf;
+    lock.lock();
+  }
+}
+
+static void flush_buf() {
+  std::unique_lock<std::mutex> lock(queue_lock);
+  queue_cv.wait(lock, [] { return full_bufs.size() < MEMTRACE_MAX_QUEUED; });
+  full_bufs.push_back(cur_buf);
+  queue_cv.notify_all();
+  cur_buf = new std::vector<MemTraceRecord>;
+  cur_buf->reserve(MEMTRACE_BUF_RECORDS);
+}
+
+static inline void emit(uint64_t addr, uint32_t size, uint8_t flags) {
+  MemTraceRecord r;
+  r.cycle = cur_cycle;
+  r.pc = cur_pc - 0x80000000;
+  r.addr = addr;
+  r.size = size;
+  r.flags = flags;
+  memset(r.pad, 0, sizeof(r.pad));
+  cur_buf->push_back(r);
+  nr_records++;
+  if (cur_buf->size() == MEMTRACE_BUF_RECORDS) {
+    flush_buf();
+  }
+}
+
+bool memtrace_open(const char *path) {
+  trace_file = gzopen(path, "wb1");
+  if (trace_file == NULL) {
+    printf("Can not create '%s'\n", path);
+    return false;
+  }
+  uint64_t magic = MEMTRACE_MAGIC;
+  gzwrite(trace_file, &magic, sizeof(magic));
+  cur_buf = new std::vector<MemTraceRecord>;
+  cur_buf->reserve(MEMTRACE_BUF_RECORDS);
+  writer_exit = false;
+  writer = std::thread(writer_main);
+  trace_open = true;
+  memtrace_on = true;
+  return true;
+}
+
+void memtrace_close() {
+  if (!trace_open) return;
+  trace_open = false;
+  memtrace_on = false;
+  flush_buf();
+  {
+    std::lock_guard<std::mutex> lock(queue_lock);
+    writer_exit = true;
+  }
+  queue_cv.notify_all();
+  writer.join();
+  delete cur_buf;
+  gzclose(trace_file);
+  printf("Memory trace: %lu records\n", nr_records);
+}
+
+void memtrace_pause(bool pause) {
+  if (!trace_open) return;
+  memtrace_on = !pause;
+  pending_read[0] = pending_read[1] = false;
+}
+
+void memtrace_tick(uint64_t cycle, uint64_t pc, uint32_t inst) {
+  cur_cycle = cycle;
+  cur_pc = pc;
+  cur_inst = inst;
+  if (pending_read[0]) {
+    // a scalar load reads one word, the access size is in funct3
+    uint32_t size = ((inst & 0x7f) == 0x03) ? 1 << ((inst >> 12) & 0x3) : 8;
+    emit(pending_idx[0] << 3, size, 0);
+    pending_read[0] = false;
+  }
+  if (pending_read[1]) {
+    emit(pending_idx[1] << 3, 64, MEMTRACE_VECTOR);
+    pending_read[1] = false;
+  }
+}
+
+void memtrace_read(uint64_t idx, bool vector) {
+  // the negedge eval repeats the read of the instruction already emitted
+  if (!memtrace_posedge) return;
+  pending_read[vector] = true;
+  pending_idx[vector] = idx;
+}
+
+void memtrace_write(uint64_t idx, const uint64_t *mask, int nr_words, bool vector) {
+  int first = -1, last = -1;
+  for (int i = 0; i < nr_words * 8; i++) {
+    if ((mask[i / 8] >> (i % 8 * 8)) & 0xff) {
+      if (first < 0) first = i;
+      last = i;
+    }
+  }
+  if (first < 0) return;
+  emit((idx << 3) + first, last - first + 1, MEMTRACE_WRITE | (vector ? MEMTRACE_VECTOR : 0));
+}
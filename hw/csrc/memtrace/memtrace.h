@@ -0,0 +1,47 @@
+#ifndef __MEMTRACE_H
+#define __MEMTRACE_H
+
+#include <cstdint>
+
+// -----------------------------------------------------------------------
+// Memory access trace
+// -----------------------------------------------------------------------
+// Records every data access the RAM DPI helpers see (scalar RAMHelper and
+// 512-bit RAMVectorHelper) as a MemTraceRecord in a gzip stream, which a
+// writer thread compresses and writes while the simulation runs. The file
+// starts with the 8-byte magic "EMUMTRC1". tool/mem_analyzer.py reads it.
+//
+// Scalar reads are word (8-byte) granular, the RAM port only sees the word
+// index; their size comes from the load instruction. Writes carry the
+// exact byte range from the write mask.
+#define MEMTRACE_MAGIC    0x314352544d554d45UL  // "EMUMTRC1"
+
+#define MEMTRACE_WRITE    0x1
+#define MEMTRACE_VECTOR   0x2
+
+struct MemTraceRecord {
+  uint64_t cycle;
+  uint32_t pc;       // offset from 0x80000000
+  uint32_t addr;     // offset from 0x80000000
+  uint16_t size;     // bytes
+  uint8_t  flags;
+  uint8_t  pad[5];
+};
+
+extern bool memtrace_on;
+// set by the harness around the two evals of a cycle: reads issued while
+// the posedge is evaluated belong to the next instruction
+extern bool memtrace_posedge;
+
+bool memtrace_open(const char *path);
+void memtrace_close();
+// stop/resume recording without closing the file (--roi)
+void memtrace_pause(bool pause);
+// called before every cycle with the pc/instruction committed in it
+void memtrace_tick(uint64_t cycle, uint64_t pc, uint32_t inst);
+
+// called from the RAM DPI helpers, idx is the 64-bit word index
+void memtrace_read(uint64_t idx, bool vector);
+void memtrace_write(uint64_t idx, const uint64_t *mask, int nr_words, bool vector);
+
+#endif
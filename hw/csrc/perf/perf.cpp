@@ -0,0 +1,54 @@
+#include <chrono>
+#include <cstdio>
+
+#include "perf.h"
+
+#ifdef EMU_PERF
+
+PerfCounter perf_counters[NR_PERF_EVENTS];
+
+static uint64_t start_ticks;
+static std::chrono::steady_clock::time_point start_time;
+
+void perf_start() {
+  start_time = std::chrono::steady_clock::now();
+  start_ticks = perf_ticks();
+}
+
+static void perf_line(const char *name, uint64_t ticks, uint64_t calls, uint64_t total_ticks, double ticks_per_sec) {
+  printf("  %-16s %10.3f s %6.1f%%", name, ticks / ticks_per_sec, 100.0 * ticks / total_ticks);
+  if (calls) {
+    printf(" %14lu calls %8.1f ns/call", calls, 1e9 * ticks / ticks_per_sec / calls);
+  }
+  printf("\n");
+}
+
+void perf_report(uint64_t cycles) {
+  uint64_t total_ticks = perf_ticks() - start_ticks;
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+  if (total_ticks == 0 || seconds <= 0) return;
+  // calibrate the TSC against the wall clock over the whole run
+  double ticks_per_sec = total_ticks / seconds;
+
+  static const char *names[NR_PERF_EVENTS] = {
+    "eval (RTL)", "dpi read", "dpi inst", "dpi write", "dpi vector", "tracing", "I/O"
+  };
+  uint64_t dpi_ticks = 0;
+  for (int i = PERF_DPI_READ; i <= PERF_DPI_VECTOR; i++) {
+    dpi_ticks += perf_counters[i].ticks;
+  }
+  uint64_t accounted = 0;
+  printf("\033[34mHost time breakdown: \033[35m%lu\033[34m cycles in %.3f s, %.0f cycles/s, %.1f ns/cycle\033[0m\n",
+    cycles, seconds, cycles / seconds, 1e9 * seconds / (cycles ? cycles : 1));
+  for (int i = 0; i < NR_PERF_EVENTS; i++) {
+    uint64_t ticks = perf_counters[i].ticks;
+    if (i == PERF_EVAL) {
+      ticks = ticks > dpi_ticks ? ticks - dpi_ticks : 0;
+    }
+    perf_line(names[i], ticks, i == PERF_EVAL ? 0 : perf_counters[i].calls, total_ticks, ticks_per_sec);
+    accounted += ticks;
+  }
+  perf_line("harness", total_ticks > accounted ? total_ticks - accounted : 0, 0, total_ticks, ticks_per_sec);
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef __PERF_H
+#define __PERF_H
+
+#include <cstdint>
+
+// -----------------------------------------------------------------------
+// Host-side speed instrumentation
+// -----------------------------------------------------------------------
+// Built with -DEMU_PERF (build.sh -P), every PerfScope adds the TSC ticks
+// between its construction and destruction to one event. Without the flag
+// PerfScope is empty and compiles away.
+//
+// The DPI helpers run inside eval(), so PERF_EVAL includes them; the
+// report subtracts them to show the time spent in the RTL model itself.
+// In multithreaded builds the DPI counters are updated without atomics
+// and are approximate.
+enum PerfEvent {
+  PERF_EVAL,
+  PERF_DPI_READ,
+  PERF_DPI_INST,
+  PERF_DPI_WRITE,
+  PERF_DPI_VECTOR,
+  PERF_TRACE,
+  PERF_IO,
+  NR_PERF_EVENTS
+};
+
+#ifdef EMU_PERF
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t perf_ticks() { return __rdtsc(); }
+#else
+#include <chrono>
+static inline uint64_t perf_ticks() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+struct PerfCounter {
+  uint64_t ticks;
+  uint64_t calls;
+};
+extern PerfCounter perf_counters[NR_PERF_EVENTS];
+
+struct PerfScope {
+  PerfScope(PerfEvent event) : event(event), start(perf_ticks()) {}
+  ~PerfScope() {
+    perf_counters[event].ticks += perf_ticks() - start;
+    perf_counters[event].calls++;
+  }
+  PerfEvent event;
+  uint64_t start;
+};
+
+// start the wall clock the breakdown is measured against
+void perf_start();
+// print the breakdown for `cycles` simulated cycles
+void perf_report(uint64_t cycles);
+
+#else
+
+struct PerfScope { PerfScope(PerfEvent) {} };
+static inline void perf_start() {}
+static inline void perf_report(uint64_t) {}
+
+#endif
+
+#endif
@@ -0,0 +1,184 @@
+// profiler.cpp
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "elf_image.h"
+#include "profiler.h"
+
+// deeper stacks are assumed to be unbalanced (longjmp, context switch)
+#define MAX_CALL_DEPTH  4096
+// number of flat profile entries printed to stdout
+#define SUMMARY_LINES   15
+
+struct CallFrame {
+  uint64_t site;     // pc of the call instruction
+  uint64_t callee;   // first pc executed after the call
+  uint64_t start;    // cycle the callee was entered
+};
+
+struct CallSite {
+  uint64_t calls;
+  uint64_t cycles;   // inclusive
+};
+
+struct FuncProfile {
+  const ElfSymbol *sym;
+  uint64_t self;
+  uint64_t inclusive;
+  uint64_t calls;
+};
+
+// pc histogram over [text_lo, text_hi), everything else in other_pcs
+static uint64_t text_lo, text_hi;
+static std::vector<uint64_t> pc_hist;
+static std::map<uint64_t, uint64_t> other_pcs;
+
+static std::vector<CallFrame> call_stack;
+static bool call_pending = false;
+static uint64_t call_site;
+static std::map< std::pair<uint64_t, uint64_t>, CallSite > call_sites;
+// inclusive cycles and calls per callee entry pc, outermost frame only
+static std::map<uint64_t, CallSite> callee_total;
+
+void profiler_init() {
+  text_lo = ~0UL;
+  text_hi = 0;
+  for (size_t i = 0; i < elf_nr_symbols(); i++) {
+    const ElfSymbol *s = elf_symbol(i);
+    if (!s->func) continue;
+    text_lo = std::min(text_lo, s->addr);
+    text_hi = std::max(text_hi, s->addr + std::max(s->size, (uint64_t)4));
+  }
+  if (text_lo >= text_hi) {
+    text_lo = text_hi = 0;
+  }
+  pc_hist.assign((text_hi - text_lo) / 4, 0);
+}
+
+static void return_from(const CallFrame &frame, uint64_t cycle) {
+  CallSite &site = call_sites[std::make_pair(frame.site, frame.callee)];
+  site.calls++;
+  site.cycles += cycle - frame.start;
+  // recursive calls are already covered by the outer frame
+  for (size_t i = 0; i < call_stack.size(); i++) {
+    if (call_stack[i].callee == frame.callee) return;
+  }
+  CallSite &total = callee_total[frame.callee];
+  total.calls++;
+  total.cycles += cycle - frame.start;
+}
+
+void profiler_tick(uint64_t cycle, uint64_t pc, uint32_t inst) {
+  if (call_pending) {
+    call_pending = false;
+    if (call_stack.size() >= MAX_CALL_DEPTH) {
+      call_stack.clear();
+    }
+    CallFrame frame = { call_site, pc, cycle };
+    call_stack.push_back(frame);
+  }
+
+  if (pc - text_lo < text_hi - text_lo) {
+    pc_hist[(pc - text_lo) >> 2]++;
+  } else {
+    other_pcs[pc]++;
+  }
+
+  uint32_t opcode = inst & 0x7f;
+  uint32_t rd = (inst >> 7) & 0x1f;
+  uint32_t rs1 = (inst >> 15) & 0x1f;
+  bool link_rd = (rd == 1 || rd == 5);
+  bool link_rs1 = (rs1 == 1 || rs1 == 5);
+  if ((opcode == 0x6f || opcode == 0x67) && link_rd) {
+    call_pending = true;
+    call_site = pc;
+  } else if (opcode == 0x67 && rd == 0 && link_rs1 && !call_stack.empty()) {
+    CallFrame frame = call_stack.back();
+    call_stack.pop_back();
+    return_from(frame, cycle + 1);
+  }
+}
+
+static bool by_self(const FuncProfile &a, const FuncProfile &b) { return a.self > b.self; }
+
+static bool by_cycles(const std::pair< std::pair<uint64_t, uint64_t>, CallSite > &a,
+                      const std::pair< std::pair<uint64_t, uint64_t>, CallSite > &b) {
+  return a.second.cycles > b.second.cycles;
+}
+
+void profiler_finish(uint64_t cycle, const char *path) {
+  // frames still open at exit (main, halt) end now
+  while (!call_stack.empty()) {
+    CallFrame frame = call_stack.back();
+    call_stack.pop_back();
+    return_from(frame, cycle);
+  }
+
+  // fold the pc histogram onto function symbols
+  std::map<const ElfSymbol *, FuncProfile> funcs;
+  uint64_t total = 0, unknown = 0;
+  for (size_t i = 0; i < pc_hist.size(); i++) {
+    if (!pc_hist[i]) continue;
+    const ElfSymbol *s = elf_find_symbol(text_lo + i * 4);
+    total += pc_hist[i];
+    if (s == NULL) { unknown += pc_hist[i]; continue; }
+    FuncProfile &f = funcs[s];
+    f.sym = s;
+    f.self += pc_hist[i];
+  }
+  for (std::map<uint64_t, uint64_t>::iterator it = other_pcs.begin(); it != other_pcs.end(); ++it) {
+    total += it->second;
+    unknown += it->second;
+  }
+  for (std::map<uint64_t, CallSite>::iterator it = callee_total.begin(); it != callee_total.end(); ++it) {
+    const ElfSymbol *s = elf_find_symbol(it->first);
+    if (s == NULL) continue;
+    FuncProfile &f = funcs[s];
+    f.sym = s;
+    f.inclusive += it->second.cycles;
+    f.calls += it->second.calls;
+  }
+  std::vector<FuncProfile> flat;
+  for (std::map<const ElfSymbol *, FuncProfile>::iterator it = funcs.begin(); it != funcs.end(); ++it) {
+    flat.push_back(it->second);
+  }
+  std::sort(flat.begin(), flat.end(), by_self);
+
+  std::vector< std::pair< std::pair<uint64_t, uint64_t>, CallSite > > sites(call_sites.begin(), call_sites.end());
+  std::sort(sites.begin(), sites.end(), by_cycles);
+
+  if (total == 0) total = 1;
+  FILE *fp = fopen(path, "w");
+  if (fp == NULL) {
+    printf("Can not create '%s'\n", path);
+  } else {
+    fprintf(fp, "Flat profile: %lu cycles\n", total);
+    fprintf(fp, "%7s %14s %14s %10s  %s\n", "self%", "self", "inclusive", "calls", "function");
+    for (size_t i = 0; i < flat.size(); i++) {
+      fprintf(fp, "%6.2f%% %14lu %14lu %10lu  %s\n", 100.0 * flat[i].self / total,
+              flat[i].self, flat[i].inclusive, flat[i].calls, flat[i].sym->name.c_str());
+    }
+    if (unknown) {
+      fprintf(fp, "%6.2f%% %14lu %14s %10s  %s\n", 100.0 * unknown / total, unknown, "-", "-", "<unknown>");
+    }
+    fprintf(fp, "\nCall-site profile: inclusive cycles per call site\n");
+    fprintf(fp, "%14s %10s %12s  %s\n", "cycles", "calls", "cycles/call", "call site -> callee");
+    for (size_t i = 0; i < sites.size(); i++) {
+      fprintf(fp, "%14lu %10lu %12.1f  %s -> %s\n", sites[i].second.cycles, sites[i].second.calls,
+              (double)sites[i].second.cycles / sites[i].second.calls,
+              elf_symbolize(sites[i].first.first).c_str(), elf_symbolize(sites[i].first.second).c_str());
+    }
+    fclose(fp);
+  }
+
+  printf("\033[34mProfile (full report in %s):\033[0m\n", path);
+  printf("  %7s %14s %14s  %s\n", "self%", "self", "inclusive", "function");
+  for (size_t i = 0; i < flat.size() && i < SUMMARY_LINES; i++) {
+    printf("  %6.2f%% %14lu %14lu  %s\n", 100.0 * flat[i].self / total,
+           flat[i].self, flat[i].inclusive, flat[i].sym->name.c_str());
+  }
+}
@@ -0,0 +1,19 @@
+#ifndef __PROFILER_H
+#define __PROFILER_H
+
+#include <cstdint>
+
+// Exact per-function cycle profiler. profiler_tick() is called once per
+// cycle with the pc and instruction the core commits in that cycle; the
+// pc is counted in a histogram and jal/jalr with rd = ra/t0 (calls) and
+// jalr x0, 0(ra/t0) (returns) maintain a shadow call stack.
+//
+// At exit the histogram is folded onto the ELF function symbols (see
+// elf_image.h, load them first) into a flat profile of self and inclusive
+// cycles, and the completed calls into a call-site profile.
+void profiler_init();
+void profiler_tick(uint64_t cycle, uint64_t pc, uint32_t inst);
+// write the full profile to path and a short summary to stdout
+void profiler_finish(uint64_t cycle, const char *path);
+
+#endif
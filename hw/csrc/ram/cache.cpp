@@ -0,0 +1,279 @@
+// cache.cpp
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <map>
+#include <vector>
+
+#include "cache.h"
+#include "elf_image.h"
+#include "dram.h"
+
+// number of per-function lines cache_report prints
+#define REPORT_LINES  20
+
+enum { REPL_LRU, REPL_FIFO, REPL_RANDOM };
+
+struct CacheConfig {
+  bool enabled;
+  uint64_t size, ways, line;
+  int policy;
+};
+
+struct CacheStats {
+  uint64_t accesses;
+  uint64_t misses;
+  uint64_t writebacks;
+};
+
+class Cache {
+public:
+  void init(const CacheConfig &cfg) {
+    line_shift = __builtin_ctzl(cfg.line);
+    ways = cfg.ways;
+    nr_sets = cfg.size / cfg.line / cfg.ways;
+    policy = cfg.policy;
+    invalidate();
+  }
+
+  // drop every line, the statistics are kept
+  void invalidate() {
+    tags.assign(nr_sets * ways, 0);
+    valid.assign(nr_sets * ways, 0);
+    dirty.assign(nr_sets * ways, 0);
+    stamp.assign(nr_sets * ways, 0);
+    clock = 0;
+    lfsr = 0x2545f4914f6cdd1dUL;
+  }
+
+  // returns true on a miss, *wb is the address of the dirty line the
+  // miss evicted or ~0
+  bool access(uint64_t addr, bool write, uint64_t *wb) {
+    *wb = ~0UL;
+    uint64_t blk = addr >> line_shift;
+    uint64_t set = blk % nr_sets;
+    uint64_t base = set * ways;
+    clock++;
+    stats.accesses++;
+    for (uint64_t w = base; w < base + ways; w++) {
+      if (valid[w] && tags[w] == blk) {
+        if (policy == REPL_LRU) stamp[w] = clock;
+        dirty[w] |= write;
+        return false;
+      }
+    }
+    stats.misses++;
+    uint64_t victim = base;
+    if (policy == REPL_RANDOM) {
+      lfsr ^= lfsr << 13; lfsr ^= lfsr >> 7; lfsr ^= lfsr << 17;
+      victim = base + lfsr % ways;
+    }
+    for (uint64_t w = base; w < base + ways; w++) {
+      if (!valid[w]) { victim = w; break; }
+      if (policy != REPL_RANDOM && stamp[w] < stamp[victim]) victim = w;
+    }
+    if (valid[victim] && dirty[victim]) {
+      stats.writebacks++;
+      *wb = tags[victim] << line_shift;
+    }
+    tags[victim] = blk;
+    valid[victim] = 1;
+    dirty[victim] = write;
+    stamp[victim] = clock;
+    return true;
+  }
+
+  uint64_t line_size() const { return 1UL << line_shift; }
+
+  CacheStats stats;
+
+private:
+  int line_shift;
+  uint64_t ways, nr_sets;
+  int policy;
+  std::vector<uint64_t> tags, stamp;
+  std::vector<uint8_t> valid, dirty;
+  uint64_t clock, lfsr;
+};
+
+// hits and misses of the instructions at one pc
+struct PcStats {
+  uint64_t i_acc, i_miss, d_acc, d_miss;
+};
+
+bool cache_on = false;
+uint64_t cache_seq = 0;
+
+static CacheConfig icache_cfg, dcache_cfg;
+static Cache icache, dcache;
+static uint64_t miss_latency = 0;
+static uint64_t stall_left = 0;
+static uint64_t stall_total = 0;
+
+static uint64_t cur_cycle, cur_pc;
+// reads of the next instruction, credited to its pc in cache_tick
+static PcStats pending;
+static std::unordered_map<uint64_t, PcStats> pc_stats;
+// last read per port, for deduplication
+static uint64_t last_seq[NR_CACHE_PORTS], last_addr[NR_CACHE_PORTS];
+
+static bool parse_spec(const char *spec, CacheConfig *cfg, const char *name) {
+  char *end;
+  cfg->size = strtoull(spec, &end, 0);
+  if (*end == 'K' || *end == 'k') { cfg->size <<= 10; end++; }
+  else if (*end == 'M' || *end == 'm') { cfg->size <<= 20; end++; }
+  bool ok = (*end == ',');
+  if (ok) cfg->ways = strtoull(end + 1, &end, 0);
+  ok = ok && (*end == ',');
+  if (ok) cfg->line = strtoull(end + 1, &end, 0);
+  cfg->policy = REPL_LRU;
+  if (ok && *end == ',') {
+    std::string p(end + 1);
+    if (p == "lru") cfg->policy = REPL_LRU;
+    else if (p == "fifo") cfg->policy = REPL_FIFO;
+    else if (p == "random") cfg->policy = REPL_RANDOM;
+    else ok = false;
+  } else if (ok && *end != '\0') {
+    ok = false;
+  }
+  ok = ok && cfg->ways > 0 && cfg->line >= 8 && (cfg->line & (cfg->line - 1)) == 0 &&
+       cfg->size % (cfg->line * cfg->ways) == 0 && cfg->size >= cfg->line * cfg->ways;
+  if (!ok) {
+    printf("ERROR: bad %s spec '%s', expected SIZE,WAYS,LINE[,lru|fifo|random]\n", name, spec);
+    return false;
+  }
+  cfg->enabled = true;
+  return true;
+}
+
+bool cache_config_icache(const char *spec) { return parse_spec(spec, &icache_cfg, "icache"); }
+bool cache_config_dcache(const char *spec) { return parse_spec(spec, &dcache_cfg, "dcache"); }
+void cache_set_miss_latency(uint64_t cycles) { miss_latency = cycles; }
+
+static void print_config(const char *name, const CacheConfig &cfg) {
+  static const char *policies[] = { "lru", "fifo", "random" };
+  if (!cfg.enabled) return;
+  printf("%s: %luKB, %lu-way, %luB lines, %s\n", name, cfg.size >> 10, cfg.ways, cfg.line, policies[cfg.policy]);
+}
+
+void cache_init() {
+  cache_on = icache_cfg.enabled || dcache_cfg.enabled || dram_enabled();
+  if (!cache_on) return;
+  if (icache_cfg.enabled) icache.init(icache_cfg);
+  if (dcache_cfg.enabled) dcache.init(dcache_cfg);
+  print_config("I-cache", icache_cfg);
+  print_config("D-cache", dcache_cfg);
+  if (miss_latency) printf("Cache miss latency: %lu cycles\n", miss_latency);
+}
+
+void cache_reset() {
+  if (!cache_on) return;
+  if (icache_cfg.enabled) icache.invalidate();
+  if (dcache_cfg.enabled) dcache.invalidate();
+  dram_reset();
+  stall_left = 0;
+  memset(&pending, 0, sizeof(pending));
+  memset(last_seq, 0, sizeof(last_seq));
+  memset(last_addr, 0, sizeof(last_addr));
+}
+
+void cache_tick(uint64_t cycle, uint64_t pc) {
+  cur_cycle = cycle;
+  cur_pc = pc;
+  if (pending.i_acc || pending.d_acc) {
+    PcStats &s = pc_stats[pc];
+    s.i_acc += pending.i_acc;
+    s.i_miss += pending.i_miss;
+    s.d_acc += pending.d_acc;
+    s.d_miss += pending.d_miss;
+    memset(&pending, 0, sizeof(pending));
+  }
+}
+
+void cache_access(int port, uint64_t addr, uint32_t size, bool write) {
+  if (!write) {
+    if (last_seq[port] == cache_seq && last_addr[port] == addr) return;
+    last_seq[port] = cache_seq;
+    last_addr[port] = addr;
+  }
+  bool inst = (port == CACHE_PORT_INST);
+  // the core is blocked until the stalls already pending are over
+  uint64_t now = cur_cycle + stall_left;
+  uint64_t nr_acc = 0, nr_miss = 0, stall = 0;
+  if (inst ? !icache_cfg.enabled : !dcache_cfg.enabled) {
+    // uncached data goes straight to DRAM, uncached fetches are free
+    if (inst || !dram_enabled()) return;
+    nr_acc = 1;
+    stall = dram_access(now, addr, size, write);
+  } else {
+    Cache &c = inst ? icache : dcache;
+    uint64_t line = c.line_size();
+    for (uint64_t a = addr & ~(line - 1); a < addr + size; a += line) {
+      uint64_t wb;
+      nr_acc++;
+      if (!c.access(a, write, &wb)) continue;
+      nr_miss++;
+      if (!dram_enabled()) {
+        stall += miss_latency;
+        continue;
+      }
+      if (wb != ~0UL) dram_access(now + stall, wb, line, true);
+      stall += dram_access(now + stall, a, line, false);
+    }
+  }
+  stall_left += stall;
+  stall_total += stall;
+  // writes happen on the edge that commits cur_pc, reads are made for the
+  // instruction that commits next
+  PcStats &s = write ? pc_stats[cur_pc] : pending;
+  if (inst) { s.i_acc += nr_acc; s.i_miss += nr_miss; }
+  else      { s.d_acc += nr_acc; s.d_miss += nr_miss; }
+}
+
+bool ram_stall_pending() {
+  if (stall_left == 0) return false;
+  stall_left--;
+  return true;
+}
+
+static void print_totals(const char *name, const CacheConfig &cfg, const CacheStats &s) {
+  if (!cfg.enabled) return;
+  printf("  %s: %lu accesses, %lu misses (%.2f%% miss rate), %lu writebacks\n", name, s.accesses, s.misses,
+         s.accesses ? 100.0 * s.misses / s.accesses : 0.0, s.writebacks);
+}
+
+static bool by_misses(const std::pair<std::string, PcStats> &a, const std::pair<std::string, PcStats> &b) {
+  return a.second.i_miss + a.second.d_miss > b.second.i_miss + b.second.d_miss;
+}
+
+void cache_report(uint64_t cycles) {
+  if (!cache_on) return;
+  printf("\033[34mMemory model:\033[0m\n");
+  print_totals("I-cache", icache_cfg, icache.stats);
+  print_totals("D-cache", dcache_cfg, dcache.stats);
+  dram_report(cycles);
+  if (stall_total) printf("  stall cycles: %lu (%.2f%% of %lu)\n", stall_total, cycles ? 100.0 * stall_total / cycles : 0.0, cycles);
+
+  // fold the pcs onto functions, or 256-byte regions without symbols
+  std::map<std::string, PcStats> regions;
+  for (std::unordered_map<uint64_t, PcStats>::iterator it = pc_stats.begin(); it != pc_stats.end(); ++it) {
+    const ElfSymbol *sym = elf_find_symbol(it->first);
+    char buf[32];
+    snprintf(buf, sizeof(buf), "0x%lx", it->first & ~0xffUL);
+    PcStats &r = regions[sym ? sym->name : std::string(buf)];
+    r.i_acc += it->second.i_acc;
+    r.i_miss += it->second.i_miss;
+    r.d_acc += it->second.d_acc;
+    r.d_miss += it->second.d_miss;
+  }
+  std::vector< std::pair<std::string, PcStats> > sorted(regions.begin(), regions.end());
+  std::sort(sorted.begin(), sorted.end(), by_misses);
+  printf("  %-36s %12s %10s %12s %10s\n", "function", "I-access", "I-miss", "D-access", "D-miss");
+  for (size_t i = 0; i < sorted.size() && i < REPORT_LINES; i++) {
+    const PcStats &s = sorted[i].second;
+    printf("  %-36s %12lu %10lu %12lu %10lu\n", sorted[i].first.substr(0, 36).c_str(), s.i_acc, s.i_miss, s.d_acc, s.d_miss);
+  }
+}
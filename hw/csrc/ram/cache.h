@@ -0,0 +1,53 @@
+#ifndef __CACHE_H
+#define __CACHE_H
+
+#include <cstdint>
+
+// -----------------------------------------------------------------------
+// L1 cache model
+// -----------------------------------------------------------------------
+// Timing-only I-cache and D-cache in front of the RAM DPI helpers: the
+// data always comes from ram.cpp, the model only tracks tags to count
+// hits and misses (write-back, write-allocate) per committed pc.
+//
+//   ROMHelper        -> I-cache
+//   RAMHelper        -> D-cache
+//   RAMVectorHelper  -> D-cache, one access per line the 64 bytes touch
+//
+// Misses go to the DRAM model (dram.h) when one is configured, otherwise
+// they cost a fixed miss latency. With latency the model stalls the core: main.cpp drives
+// top's mem_stall input (rvcpu's pc_stall) while ram_stall_pending()
+// reports pending cycles; top.v feeds a nop to the core meanwhile.
+//
+// The read helpers are combinational and may run more than once for one
+// instruction, so reads are deduplicated per port on (address, sequence
+// number of the instruction), which main.cpp advances with
+// cache_next_inst() on every clock edge that commits an instruction.
+enum { CACHE_PORT_INST, CACHE_PORT_DATA, CACHE_PORT_VECTOR, NR_CACHE_PORTS };
+
+extern bool cache_on;
+extern uint64_t cache_seq;
+static inline void cache_next_inst() { cache_seq++; }
+
+// SPEC is SIZE,WAYS,LINE[,lru|fifo|random], SIZE may end in K or M
+bool cache_config_icache(const char *spec);
+bool cache_config_dcache(const char *spec);
+void cache_set_miss_latency(uint64_t cycles);
+
+// allocate the configured caches, call once before the simulation
+void cache_init();
+// cold caches, idle DRAM and no pending stalls, for the next batch image;
+// the hit/miss counts keep adding up
+void cache_reset();
+// cycle and pc of the instruction about to commit, called before every cycle
+void cache_tick(uint64_t cycle, uint64_t pc);
+// print totals and per-function hit/miss counts (ELF symbols if loaded)
+void cache_report(uint64_t cycles);
+
+// called from the DPI helpers with the byte address of the access
+void cache_access(int port, uint64_t addr, uint32_t size, bool write);
+
+// true if the core has to stall this cycle, consumes one pending cycle
+bool ram_stall_pending();
+
+#endif
@@ -44,6 +44,15 @@
 
 #define EMU_DATA_INDEX (EMU_RAM_SIZE/ sizeof(uint64_t) /2.UL)
 
+// vector memory port: one 512-bit line = 8 x 64-bit words
+#define EMU_VLINE_WORDS 8
+#define EMU_VLINE_BYTES (EMU_VLINE_WORDS * sizeof(uint64_t))
+
+// dirty-page tracking granularity used by save_data
+#define EMU_PAGE_SHIFT 12
+#define EMU_PAGE_SIZE  (1UL << EMU_PAGE_SHIFT)
+#define EMU_NR_PAGES   (EMU_RAM_SIZE / EMU_PAGE_SIZE)
+
 // first valid instruction's address, difftest starts from this instruction
 #define FIRST_INST_ADDRESS 0x80000000
 
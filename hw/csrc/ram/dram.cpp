@@ -0,0 +1,88 @@
+// dram.cpp
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "dram.h"
+
+struct DramBank {
+  bool open;
+  uint64_t row;
+  uint64_t ready;   // cycle the bank can take the next command
+};
+
+static bool enabled = false;
+static uint64_t t_cas, bytes_per_cycle, nr_banks = 8, row_size = 2048, t_row_miss;
+static std::vector<DramBank> banks;
+static uint64_t bus_free = 0;
+
+static uint64_t nr_reads, nr_writes, nr_bytes, row_hits, row_misses, read_cycles;
+
+bool dram_config(const char *spec) {
+  char *end;
+  t_cas = strtoull(spec, &end, 0);
+  bool ok = (*end == ',');
+  if (ok) bytes_per_cycle = strtoull(end + 1, &end, 0);
+  t_row_miss = 2 * t_cas;
+  if (ok && *end == ',') nr_banks = strtoull(end + 1, &end, 0);
+  if (ok && *end == ',') row_size = strtoull(end + 1, &end, 0);
+  if (ok && *end == ',') t_row_miss = strtoull(end + 1, &end, 0);
+  ok = ok && *end == '\0' && bytes_per_cycle > 0 && nr_banks > 0 && row_size > 0;
+  if (!ok) {
+    printf("ERROR: bad dram spec '%s', expected LAT,BW[,BANKS,ROW,ROW_MISS]\n", spec);
+    return false;
+  }
+  DramBank idle = { false, 0, 0 };
+  banks.assign(nr_banks, idle);
+  enabled = true;
+  printf("DRAM: CAS %lu, row miss +%lu cycles, %lu B/cycle, %lu banks of %luB rows\n",
+         t_cas, t_row_miss, bytes_per_cycle, nr_banks, row_size);
+  return true;
+}
+
+bool dram_enabled() { return enabled; }
+
+void dram_reset() {
+  if (!enabled) return;
+  DramBank idle = { false, 0, 0 };
+  banks.assign(nr_banks, idle);
+  bus_free = 0;
+}
+
+uint64_t dram_access(uint64_t now, uint64_t addr, uint32_t bytes, bool write) {
+  uint64_t row = addr / row_size;
+  DramBank &bank = banks[row % nr_banks];
+  uint64_t start = std::max(now, bank.ready);
+  uint64_t latency = t_cas;
+  if (bank.open && bank.row == row) {
+    row_hits++;
+  } else {
+    row_misses++;
+    latency += t_row_miss;
+    bank.open = true;
+    bank.row = row;
+  }
+  uint64_t xfer = (bytes + bytes_per_cycle - 1) / bytes_per_cycle;
+  uint64_t data_start = std::max(start + latency, bus_free);
+  uint64_t done = data_start + xfer;
+  bus_free = done;
+  bank.ready = done;
+
+  nr_bytes += bytes;
+  if (write) {
+    nr_writes++;
+    return 0;
+  }
+  nr_reads++;
+  read_cycles += done - now;
+  return done - now;
+}
+
+void dram_report(uint64_t cycles) {
+  if (!enabled) return;
+  uint64_t nr = row_hits + row_misses;
+  printf("  DRAM: %lu reads (%.1f cycles avg), %lu writes, %lu bytes (%.3f B/cycle), row hit rate %.2f%%\n",
+         nr_reads, nr_reads ? (double)read_cycles / nr_reads : 0.0, nr_writes, nr_bytes,
+         cycles ? (double)nr_bytes / cycles : 0.0, nr ? 100.0 * row_hits / nr : 0.0);
+}
@@ -0,0 +1,35 @@
+#ifndef __DRAM_H
+#define __DRAM_H
+
+#include <cstdint>
+
+// -----------------------------------------------------------------------
+// DRAM timing model
+// -----------------------------------------------------------------------
+// Banked DRAM with open-row buffers behind the cache model (cache.h):
+// line fills and writebacks go here, and without a D-cache every scalar
+// or vector data access does. Instruction fetches without an I-cache are
+// not timed (on-chip instruction memory).
+//
+// An access to bank (addr / ROW) % BANKS waits for the bank, pays the CAS
+// latency on a row hit or CAS + ROW_MISS on a row miss, then holds the
+// shared data bus for bytes / BW cycles. Reads stall the core until the
+// data is back; writes are posted and only occupy the bank and the bus.
+//
+// SPEC is LAT,BW[,BANKS,ROW,ROW_MISS]:
+//   LAT       CAS latency in core cycles
+//   BW        bus bandwidth in bytes per core cycle
+//   BANKS     number of banks (default 8)
+//   ROW       row size in bytes (default 2048)
+//   ROW_MISS  extra cycles to precharge and activate (default 2 * LAT)
+bool dram_config(const char *spec);
+bool dram_enabled();
+
+// Returns the number of cycles from `now` until the access completes.
+uint64_t dram_access(uint64_t now, uint64_t addr, uint32_t bytes, bool write);
+// close all rows and idle the banks and the bus, the counters are kept
+void dram_reset();
+
+void dram_report(uint64_t cycles);
+
+#endif
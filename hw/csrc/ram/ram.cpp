@@ -15,18 +15,61 @@
 ***************************************************************************************/
 
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+#include <utility>
+#include <algorithm>
 
 #include "config.h"
 #include "ram.h"
+#include "ram_policy.h"
+#include "perf.h"
+#include "elf_image.h"
+#include "memtrace.h"
+#include "cache.h"
 
 static uint64_t *ram;
 static long img_size = 0;
-static pthread_mutex_t ram_mutex;
+static const char *inst_img = NULL;
+
+// pages written by the program (or loaded with load_data) since init_ram,
+// one byte per page so the write helpers can mark them with a plain store
+static uint8_t ram_dirty[EMU_NR_PAGES];
+#define MARK_DIRTY(idx)  (ram_dirty[(idx) >> (EMU_PAGE_SHIFT - 3)] = 1)
+
+// number of enabled scalar and vector stores, for the hang watchdog;
+// updated through RamPolicy::count like the RAM words
+static uint64_t ram_writes = 0;
+
+// save_data output: flat dump, or sparse container of dirty pages or of
+// explicitly requested windows (RAM offsets)
+static bool save_flat = false;
+static std::vector< std::pair<uint64_t, uint64_t> > save_windows;
+
+// sparse save container, all fields little-endian uint64_t:
+//   magic "EMUSPRS1", base address, flat size, number of ranges,
+//   then for every range: address, length, data[length]
+#define SPARSE_MAGIC 0x3153525053554d45UL  // "EMUSPRS1"
 
 uint64_t* get_img_start() { return &ram[0]; }
 long get_img_size() { return img_size; }
 uint64_t* get_ram_start() { return &ram[0]; }
 long get_ram_size() { return EMU_RAM_SIZE; }
+uint8_t* get_ram_dirty_map() { return ram_dirty; }
+uint64_t get_ram_write_count() { return RamPolicy::load(&ram_writes); }
+
+void ram_save_flat(bool flat) { save_flat = flat; }
+
+void ram_add_save_window(uint64_t addr, uint64_t size) {
+  addr -= 0x80000000;
+  if (addr >= EMU_RAM_SIZE || size > EMU_RAM_SIZE - addr) {
+    printf("ERROR: save window 0x%lx+0x%lx out of bound!\n", addr + 0x80000000, size);
+    assert(0);
+  }
+  save_windows.push_back(std::make_pair(addr, size));
+}
 
 void init_memory(){
   printf("Using simulated %luMB RAM\n", EMU_RAM_SIZE / (1024 * 1024));
@@ -37,22 +80,57 @@ void init_memory(){
   }
 }
 
+// Map the image file MAP_PRIVATE|MAP_FIXED over the RAM at ram_ptr: pages
+// are faulted in lazily from the page cache, shared between emulator
+// processes loading the same file, and copied only when written.
+static bool map_img(uint64_t *ram_ptr, int fd, long size) {
+  long page_size = sysconf(_SC_PAGESIZE);
+  if ((uintptr_t)ram_ptr % page_size) {
+    return false;
+  }
+  long map_size = (size + page_size - 1) / page_size * page_size;
+  void *p = mmap(ram_ptr, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0);
+  return p != MAP_FAILED;
+}
+
+// Copy the loadable segments of an ELF image into RAM and zero its BSS.
+static void load_elf(const char *img) {
+  img_size = elf_load_image(img, (uint8_t *)ram, 0x80000000, EMU_RAM_SIZE);
+  if (img_size == 0) {
+    printf("Can not load ELF image '%s'\n", img);
+    assert(0);
+  }
+}
+
 void load_img(uint64_t *ram_ptr, const char *img){
   assert(img != NULL);
   printf("The image is %s\n", img);
+  if (ram_ptr == ram && elf_is_elf(img)) {
+    load_elf(img);
+    return;
+  }
 
-  int ret;
-  FILE *fp = fopen(img, "rb");
-  if (fp == NULL) {
+  int fd = open(img, O_RDONLY);
+  if (fd < 0) {
     printf("Can not open '%s'\n", img);
     assert(0);
   }
-  fseek(fp, 0, SEEK_END);
-  img_size = ftell(fp);
-  if (img_size > EMU_RAM_SIZE) {
-    img_size = EMU_RAM_SIZE;
+  struct stat st;
+  int ret = fstat(fd, &st);
+  assert(ret == 0);
+  img_size = st.st_size;
+  long room = EMU_RAM_SIZE - (ram_ptr - ram) * sizeof(uint64_t);
+  if (img_size > room) {
+    img_size = room;
+  }
+  if (img_size == 0 || map_img(ram_ptr, fd, img_size)) {
+    close(fd);
+    return;
   }
-  fseek(fp, 0, SEEK_SET);
+
+  // not page aligned: fall back to copying the file in
+  FILE *fp = fdopen(fd, "rb");
+  assert(fp != NULL);
   ret = fread(ram_ptr, img_size, 1, fp);
   assert(ret == 1);
   fclose(fp);
@@ -68,22 +146,30 @@ void save_img(uint64_t *ram_ptr, uint64_t size, const char *img){
   fclose(fp);
 }
 
-void init_mutex(){
-  pthread_mutex_init(&ram_mutex, 0);
-}
-
 void init_ram(const char *img) {
   // initialize memory using Linux mmap
   init_memory();
   // read bin file
+  inst_img = img;
   load_img( ram, img );
-  // initialize pthread_mutex
-  init_mutex();
+}
+
+// Throw away everything the last run wrote: map fresh zero pages over the
+// whole RAM and map the instruction image back in. Both are mmap calls, so
+// the cost does not depend on how much of the RAM the program touched.
+void ram_reset() {
+  RamPolicy::Guard guard;
+  void *p = mmap(ram, EMU_RAM_SIZE, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE | MAP_FIXED, -1, 0);
+  if (p == MAP_FAILED) {
+    printf("Cound not remap 0x%lx bytes\n", EMU_RAM_SIZE);
+    assert(0);
+  }
+  memset(ram_dirty, 0, sizeof(ram_dirty));
+  load_img( ram, inst_img );
 }
 
 void ram_finish() {
   munmap(ram, EMU_RAM_SIZE);
-  pthread_mutex_destroy(&ram_mutex);
 }
 
 void load_data( uint64_t addr, const char *img){
@@ -104,9 +190,31 @@ void load_data( uint64_t addr, const char *img){
   ram_ptr = get_ram_start();
   ram_ptr = ram_ptr + ptr_offset ;
 
-  pthread_mutex_lock(&ram_mutex);
+  RamPolicy::Guard guard;
   load_img( ram_ptr, img );
-  pthread_mutex_unlock(&ram_mutex);
+  for (uint64_t i = addr >> EMU_PAGE_SHIFT; i <= (addr + img_size - 1) >> EMU_PAGE_SHIFT && i < EMU_NR_PAGES; i++) {
+    ram_dirty[i] = 1;
+  }
+}
+
+// write [addr, addr + size) as a sparse container holding only `ranges`
+static void save_sparse(uint64_t addr, uint64_t size, const std::vector< std::pair<uint64_t, uint64_t> > &ranges, const char *img) {
+  FILE *fp = fopen(img, "wb");
+  if (fp == NULL) {
+    printf("Can not create '%s'\n", img);
+    assert(0);
+  }
+  uint64_t header[4] = { SPARSE_MAGIC, addr + 0x80000000, size, ranges.size() };
+  fwrite(header, sizeof(header), 1, fp);
+  uint64_t bytes = 0;
+  for (size_t i = 0; i < ranges.size(); i++) {
+    uint64_t range[2] = { ranges[i].first + 0x80000000, ranges[i].second };
+    fwrite(range, sizeof(range), 1, fp);
+    fwrite((uint8_t *)ram + ranges[i].first, ranges[i].second, 1, fp);
+    bytes += ranges[i].second;
+  }
+  fclose(fp);
+  printf("Saved %lu bytes in %lu range(s)\n", bytes, ranges.size());
 }
 
 void save_data( uint64_t addr, const char *img){
@@ -130,50 +238,132 @@ void save_data( uint64_t addr, const char *img){
   ram_ptr = get_ram_start();
   ram_ptr = ram_ptr + ptr_offset ;  
 
-  pthread_mutex_lock(&ram_mutex);
-  save_img( ram_ptr, size, img );
-  pthread_mutex_unlock(&ram_mutex);
+  RamPolicy::Guard guard;
+  if (save_flat) {
+    save_img( ram_ptr, size, img );
+    return;
+  }
+
+  // explicit windows if any were requested, otherwise the dirty pages
+  std::vector< std::pair<uint64_t, uint64_t> > ranges;
+  if (!save_windows.empty()) {
+    for (size_t i = 0; i < save_windows.size(); i++) {
+      uint64_t start = std::max(save_windows[i].first, addr);
+      uint64_t end = save_windows[i].first + save_windows[i].second;
+      if (start < end) ranges.push_back(std::make_pair(start, end - start));
+    }
+  } else {
+    for (uint64_t i = addr >> EMU_PAGE_SHIFT; i < EMU_NR_PAGES; i++) {
+      if (!ram_dirty[i]) continue;
+      uint64_t start = std::max(i << EMU_PAGE_SHIFT, addr);
+      while (i + 1 < EMU_NR_PAGES && ram_dirty[i + 1]) i++;
+      ranges.push_back(std::make_pair(start, ((i + 1) << EMU_PAGE_SHIFT) - start));
+    }
+  }
+  save_sparse( addr, size, ranges, img );
 }
 
 extern "C" uint64_t ram_read_helper(uint8_t en, uint64_t rIdx) {
+  PerfScope perf(PERF_DPI_READ);
   if (!ram)
     return 0;
   if (en && rIdx >= EMU_RAM_SIZE / sizeof(uint64_t)) {
     rIdx %= EMU_RAM_SIZE / sizeof(uint64_t);
   }
-  pthread_mutex_lock(&ram_mutex);
-  uint64_t rdata = (en) ? ram[rIdx] : 0;
-  pthread_mutex_unlock(&ram_mutex);
-  
-  return rdata;
+  if (!en)
+    return 0;
+  if (memtrace_on)
+    memtrace_read(rIdx, false);
+  if (cache_on)
+    cache_access(CACHE_PORT_DATA, 0x80000000 + (rIdx << 3), 8, false);
+  RamPolicy::Guard guard;
+  return RamPolicy::load(&ram[rIdx]);
 }
 
 extern "C" uint64_t ram_inst_helper(uint8_t en, uint64_t rIdx) {
+  PerfScope perf(PERF_DPI_INST);
   if (!ram)
     return 0;
   if (en && rIdx >= EMU_RAM_SIZE / sizeof(uint64_t)) {
     rIdx %= EMU_RAM_SIZE / sizeof(uint64_t);
   }
-  pthread_mutex_lock(&ram_mutex);
-  uint64_t rdata = (en) ? ram[rIdx] : 0;
-  pthread_mutex_unlock(&ram_mutex);
+  if (!en)
+    return 0;
+  if (cache_on)
+    cache_access(CACHE_PORT_INST, 0x80000000 + (rIdx << 3), 8, false);
+  RamPolicy::Guard guard;
+  uint64_t rdata = RamPolicy::load(&ram[rIdx]);
   // printf("Read\t rIdx: 0x%lx \t rdata: 0x%lx \n", rIdx, rdata );
   return rdata;
 }
 
 extern "C" void ram_write_helper(uint64_t wIdx, uint64_t wdata, uint64_t wmask, uint8_t wen) {
+  PerfScope perf(PERF_DPI_WRITE);
   if (wen && ram) {
     if (wIdx >= EMU_RAM_SIZE / sizeof(uint64_t)) {
       printf("ERROR: ram wIdx = 0x%lx out of bound!\n", wIdx);
       assert(wIdx < EMU_RAM_SIZE / sizeof(uint64_t));
     }
-    pthread_mutex_lock(&ram_mutex);
-    ram[wIdx] = (ram[wIdx] & ~wmask) | (wdata & wmask);
-    pthread_mutex_unlock(&ram_mutex);
+    RamPolicy::Guard guard;
+    RamPolicy::store(&ram[wIdx], wdata, wmask);
+    MARK_DIRTY(wIdx);
+    RamPolicy::count(&ram_writes);
+    if (memtrace_on)
+      memtrace_write(wIdx, &wmask, 1, false);
+    if (cache_on)
+      cache_access(CACHE_PORT_DATA, 0x80000000 + (wIdx << 3), 8, true);
     // printf("\033[32mWrite\033[0m\t wIdx: 0x%lx \t wdata: 0x%lx \t wmask: 0x%lx \n", wIdx, wdata, wmask);
   }
 }
 
+// 512-bit vector line helpers. svBitVecVal is a uint32_t array holding the
+// line LSB-first, which on a little-endian host is the same byte order as
+// the 8 consecutive 64-bit RAM words, so a line is moved with one memcpy.
+extern "C" void ram_vread512_helper(uint8_t en, uint64_t rIdx, uint32_t *rdata) {
+  PerfScope perf(PERF_DPI_VECTOR);
+  if (!ram || !en) {
+    memset(rdata, 0, EMU_VLINE_BYTES);
+    return;
+  }
+  const uint64_t nr_words = EMU_RAM_SIZE / sizeof(uint64_t);
+  if (memtrace_on)
+    memtrace_read(rIdx, true);
+  if (cache_on)
+    cache_access(CACHE_PORT_VECTOR, 0x80000000 + (rIdx << 3), EMU_VLINE_BYTES, false);
+  RamPolicy::Guard guard;
+  if (rIdx <= nr_words - EMU_VLINE_WORDS) {
+    RamPolicy::load_line(&ram[rIdx], rdata);
+  } else {
+    // the line wraps around the end of RAM, same as ram_read_helper
+    for (int i = 0; i < EMU_VLINE_WORDS; i++) {
+      uint64_t rdata_word = RamPolicy::load(&ram[(rIdx + i) % nr_words]);
+      memcpy(&rdata[2 * i], &rdata_word, sizeof(uint64_t));
+    }
+  }
+}
+
+extern "C" void ram_vwrite512_helper(uint64_t wIdx, const uint32_t *wdata, const uint32_t *wmask, uint8_t wen) {
+  PerfScope perf(PERF_DPI_VECTOR);
+  if (wen && ram) {
+    if (wIdx > EMU_RAM_SIZE / sizeof(uint64_t) - EMU_VLINE_WORDS) {
+      printf("ERROR: vram wIdx = 0x%lx out of bound!\n", wIdx);
+      assert(wIdx <= EMU_RAM_SIZE / sizeof(uint64_t) - EMU_VLINE_WORDS);
+    }
+    uint64_t data[EMU_VLINE_WORDS], mask[EMU_VLINE_WORDS];
+    memcpy(data, wdata, EMU_VLINE_BYTES);
+    memcpy(mask, wmask, EMU_VLINE_BYTES);
+    RamPolicy::Guard guard;
+    RamPolicy::store_line(&ram[wIdx], data, mask);
+    MARK_DIRTY(wIdx);
+    MARK_DIRTY(wIdx + EMU_VLINE_WORDS - 1);
+    RamPolicy::count(&ram_writes);
+    if (memtrace_on)
+      memtrace_write(wIdx, mask, EMU_VLINE_WORDS, true);
+    if (cache_on)
+      cache_access(CACHE_PORT_VECTOR, 0x80000000 + (wIdx << 3), EMU_VLINE_BYTES, true);
+  }
+}
+
 uint64_t pmem_read(uint64_t raddr) {
   if (raddr % sizeof(uint64_t)) {
     printf("Warning: pmem_read only supports 64-bit aligned memory access\n");
@@ -25,6 +25,18 @@
 
 void init_ram(const char *img);
 void ram_finish();
+// restore the RAM to the state right after init_ram (batch mode)
+void ram_reset();
+
+uint64_t* get_ram_start();
+long get_ram_size();
+uint8_t* get_ram_dirty_map();
+uint64_t get_ram_write_count();
+
+// save_data writes a sparse container of the dirty pages by default;
+// with windows only those are written, with flat the old full dump
+void ram_save_flat(bool flat);
+void ram_add_save_window(uint64_t addr, uint64_t size);
 
 void load_data( uint64_t addr, const char *img);
 void save_data( uint64_t addr, const char *img);
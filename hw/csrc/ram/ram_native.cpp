@@ -0,0 +1,46 @@
+// ram_native.cpp
+#include "config.h"
+#include "ram.h"
+#include "ram_native.h"
+#include "Vtop.h"
+
+#ifdef EMU_NATIVE_RAM
+#include "Vtop___024root.h"
+
+static inline uint64_t *model_ram(Vtop *top) {
+  return &top->rootp->top__DOT__ram_mem[0];
+}
+
+static_assert(sizeof(((Vtop___024root *)0)->top__DOT__ram_mem) == EMU_RAM_SIZE,
+              "EMU_RAM_WORDS in top.v does not match EMU_RAM_SIZE");
+
+void native_ram_load(Vtop *top) {
+  memcpy(model_ram(top), get_ram_start(), EMU_RAM_SIZE);
+}
+
+void native_ram_save(Vtop *top) {
+  const uint8_t *src = (const uint8_t *)model_ram(top);
+  uint8_t *dst = (uint8_t *)get_ram_start();
+  uint8_t *dirty = get_ram_dirty_map();
+  for (uint64_t i = 0; i < EMU_NR_PAGES; i++, src += EMU_PAGE_SIZE, dst += EMU_PAGE_SIZE) {
+    if (memcmp(dst, src, EMU_PAGE_SIZE) == 0) continue;
+    memcpy(dst, src, EMU_PAGE_SIZE);
+    dirty[i] = 1;
+  }
+}
+
+uint64_t native_ram_write_count(Vtop *top) {
+  return top->rootp->top__DOT__ram_writes;
+}
+
+#else
+
+void native_ram_load(Vtop *top) {}
+
+void native_ram_save(Vtop *top) {}
+
+uint64_t native_ram_write_count(Vtop *top) {
+  return get_ram_write_count();
+}
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef __RAM_NATIVE_H
+#define __RAM_NATIVE_H
+
+#include <cstdint>
+
+class Vtop;
+
+// -----------------------------------------------------------------------
+// Native RAM backdoor
+// -----------------------------------------------------------------------
+// A build.sh -N model keeps the RAM as a Verilog array in top.v instead
+// of calling the DPI helpers. The host RAM of ram.cpp still holds the
+// images and produces the save file; these copy it into the model before
+// a run and back out of it afterwards, through the /*verilator public*/
+// handle of the array. In a DPI build they do nothing.
+//
+// The cache model, the memory trace and RAM write counting live in the
+// DPI helpers and are not available with the native RAM.
+
+// host RAM -> model, after init_ram/load_data (or ram_reset)
+void native_ram_load(Vtop *top);
+// model -> host RAM before save_data or a checkpoint; pages that changed
+// are marked dirty so the sparse save file covers them
+void native_ram_save(Vtop *top);
+// enabled stores so far, get_ram_write_count() in a DPI build
+uint64_t native_ram_write_count(Vtop *top);
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef __RAM_POLICY_H
+#define __RAM_POLICY_H
+
+#include <cstdint>
+#include <cstring>
+#include <pthread.h>
+#include "config.h"
+
+// -----------------------------------------------------------------------
+// RAM concurrency policy
+// -----------------------------------------------------------------------
+// Every DPI helper in ram.cpp goes through one of the policies below,
+// selected at compile time with -DRAM_POLICY=...
+//
+//   RAM_POLICY_SINGLE : plain loads/stores, no locking (default, the
+//                       emulator evaluates the model on a single thread)
+//   RAM_POLICY_ATOMIC : per-word atomics, for multithreaded Verilator
+//                       builds where DPI calls may run concurrently
+//   RAM_POLICY_MUTEX  : one global mutex around every access (the old
+//                       behaviour, kept as a reference point)
+//
+// Each policy provides:
+//   Guard              RAII object held for the duration of one access
+//   load/store         one 64-bit word, store merges under a bit mask
+//   load_line/store_line
+//                      one 512-bit vector line (EMU_VLINE_WORDS words)
+//   count              bump a statistics counter shared by the helpers
+#define RAM_POLICY_SINGLE 0
+#define RAM_POLICY_ATOMIC 1
+#define RAM_POLICY_MUTEX  2
+
+#ifndef RAM_POLICY
+#define RAM_POLICY RAM_POLICY_SINGLE
+#endif
+
+struct RamSingleThread {
+  struct Guard { Guard() {} };
+  static inline uint64_t load(const uint64_t *p) { return *p; }
+  static inline void store(uint64_t *p, uint64_t data, uint64_t mask) {
+    *p = (*p & ~mask) | (data & mask);
+  }
+  static inline void load_line(const uint64_t *line, uint32_t *dst) {
+    memcpy(dst, line, EMU_VLINE_BYTES);
+  }
+  static inline void store_line(uint64_t *line, const uint64_t *data, const uint64_t *mask) {
+    for (int i = 0; i < EMU_VLINE_WORDS; i++) {
+      line[i] = (line[i] & ~mask[i]) | (data[i] & mask[i]);
+    }
+  }
+  static inline void count(uint64_t *c) { (*c)++; }
+};
+
+struct RamAtomicWord {
+  struct Guard { Guard() {} };
+  static inline uint64_t load(const uint64_t *p) {
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+  }
+  static inline void store(uint64_t *p, uint64_t data, uint64_t mask) {
+    if (mask == ~0UL) {
+      __atomic_store_n(p, data, __ATOMIC_RELAXED);
+      return;
+    }
+    if (mask == 0) return;
+    uint64_t old_data = __atomic_load_n(p, __ATOMIC_RELAXED);
+    uint64_t new_data;
+    do {
+      new_data = (old_data & ~mask) | (data & mask);
+    } while (!__atomic_compare_exchange_n(p, &old_data, new_data, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  }
+  static inline void load_line(const uint64_t *line, uint32_t *dst) {
+    for (int i = 0; i < EMU_VLINE_WORDS; i++) {
+      uint64_t word = load(&line[i]);
+      memcpy(&dst[2 * i], &word, sizeof(uint64_t));
+    }
+  }
+  static inline void store_line(uint64_t *line, const uint64_t *data, const uint64_t *mask) {
+    for (int i = 0; i < EMU_VLINE_WORDS; i++) {
+      store(&line[i], data[i], mask[i]);
+    }
+  }
+  static inline void count(uint64_t *c) { __atomic_fetch_add(c, 1, __ATOMIC_RELAXED); }
+};
+
+struct RamGlobalMutex : RamSingleThread {
+  static pthread_mutex_t *mutex() {
+    static pthread_mutex_t ram_mutex = PTHREAD_MUTEX_INITIALIZER;
+    return &ram_mutex;
+  }
+  struct Guard {
+    Guard()  { pthread_mutex_lock(mutex()); }
+    ~Guard() { pthread_mutex_unlock(mutex()); }
+  };
+};
+
+#if RAM_POLICY == RAM_POLICY_SINGLE
+typedef RamSingleThread RamPolicy;
+#elif RAM_POLICY == RAM_POLICY_ATOMIC
+typedef RamAtomicWord RamPolicy;
+#elif RAM_POLICY == RAM_POLICY_MUTEX
+typedef RamGlobalMutex RamPolicy;
+#else
+#error "Unknown RAM_POLICY"
+#endif
+
+#endif
@@ -0,0 +1,129 @@
+// roi.cpp
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "roi.h"
+
+#define ROI_ALL  -2
+#define ROI_NONE -1
+
+struct RoiStats {
+  bool     open;
+  uint64_t begin_cycle, begin_stalls;
+  uint64_t entries, cycles, stalls;
+};
+
+bool roi_active = true;
+uint64_t roi_stall_cycles = 0;
+
+static RoiStats regions[ROI_NR_IDS];
+static int selected = ROI_NONE;
+static int nr_open = 0;
+static uint64_t nr_unmatched = 0;
+
+bool roi_select(const char *spec) {
+  char *end;
+  long id = strtol(spec, &end, 0);
+  if (strcmp(spec, "all") == 0) {
+    selected = ROI_ALL;
+  } else if (*end == '\0' && end != spec && id >= 0 && id < ROI_NR_IDS) {
+    selected = id;
+  } else {
+    printf("\033[31mERROR: --roi expects a region id 0..%d or 'all': %s\033[0m\n", ROI_NR_IDS - 1, spec);
+    return false;
+  }
+  roi_active = false;
+  return true;
+}
+
+bool roi_selected() {
+  return selected != ROI_NONE;
+}
+
+void roi_reset() {
+  for (int i = 0; i < ROI_NR_IDS; i++) regions[i].open = false;
+  nr_open = 0;
+  roi_active = selected == ROI_NONE;
+}
+
+static void update_active() {
+  if (selected == ROI_ALL) roi_active = nr_open > 0;
+  else if (selected != ROI_NONE) roi_active = regions[selected].open;
+}
+
+// roi_stall_cycles, nr_unmatched, then id, open, begin cycle, begin
+// stalls, entries, cycles, stalls of every region used so far
+#define ROI_STATE_WORDS 7
+
+void roi_save(std::vector<uint64_t> *state) {
+  state->clear();
+  state->push_back(roi_stall_cycles);
+  state->push_back(nr_unmatched);
+  for (int i = 0; i < ROI_NR_IDS; i++) {
+    const RoiStats &r = regions[i];
+    if (!r.open && !r.entries) continue;
+    uint64_t words[ROI_STATE_WORDS] = { (uint64_t)i, r.open, r.begin_cycle, r.begin_stalls, r.entries, r.cycles, r.stalls };
+    state->insert(state->end(), words, words + ROI_STATE_WORDS);
+  }
+}
+
+bool roi_restore(const std::vector<uint64_t> &state) {
+  if (state.size() < 2 || (state.size() - 2) % ROI_STATE_WORDS) return false;
+  memset(regions, 0, sizeof(regions));
+  nr_open = 0;
+  roi_stall_cycles = state[0];
+  nr_unmatched = state[1];
+  for (size_t k = 2; k < state.size(); k += ROI_STATE_WORDS) {
+    if (state[k] >= ROI_NR_IDS) return false;
+    RoiStats &r = regions[state[k]];
+    r.open = state[k + 1];
+    r.begin_cycle = state[k + 2];
+    r.begin_stalls = state[k + 3];
+    r.entries = state[k + 4];
+    r.cycles = state[k + 5];
+    r.stalls = state[k + 6];
+    nr_open += r.open;
+  }
+  update_active();
+  return true;
+}
+
+void roi_marker(uint64_t cycle, uint32_t inst) {
+  uint32_t funct3 = (inst >> 12) & 0x7;
+  if ((inst & 0xf8f80) != 0 || funct3 > 1) return;   // rd, rs1 must be 0
+  RoiStats &r = regions[inst >> 20];
+  if (funct3 == 0) {
+    if (r.open) nr_unmatched++;
+    else nr_open++;
+    r.open = true;
+    r.begin_cycle = cycle;
+    r.begin_stalls = roi_stall_cycles;
+  } else {
+    if (!r.open) {
+      nr_unmatched++;
+      return;
+    }
+    r.open = false;
+    nr_open--;
+    r.entries++;
+    r.cycles += cycle - r.begin_cycle;
+    r.stalls += roi_stall_cycles - r.begin_stalls;
+  }
+  update_active();
+}
+
+void roi_report(uint64_t cycles) {
+  bool any = false;
+  for (int i = 0; i < ROI_NR_IDS; i++) any |= regions[i].entries > 0;
+  if (!any && !nr_unmatched) return;
+  printf("\033[34mRegions of interest:\033[0m\n");
+  printf("  %6s %10s %14s %8s %14s %12s\n", "id", "entries", "cycles", "share", "stall cycles", "cycles/entry");
+  for (int i = 0; i < ROI_NR_IDS; i++) {
+    const RoiStats &r = regions[i];
+    if (!r.entries) continue;
+    printf("  %6d %10lu %14lu %7.2f%% %14lu %12lu\n", i, r.entries, r.cycles,
+           cycles ? 100.0 * r.cycles / cycles : 0.0, r.stalls, r.cycles / r.entries);
+  }
+  if (nr_unmatched) printf("  %lu unmatched ROI_BEGIN/ROI_END marker(s)\n", nr_unmatched);
+}
@@ -0,0 +1,57 @@
+#ifndef __ROI_H
+#define __ROI_H
+
+#include <cstdint>
+#include <vector>
+
+// -----------------------------------------------------------------------
+// Region-of-interest markers
+// -----------------------------------------------------------------------
+// A program brackets a region with ROI_BEGIN(id) / ROI_END(id) (klib
+// klib-macros.h), which emit the marker instruction
+//
+//   imm[31:20] = id | funct3 (0 begin, 1 end) | rs1 = 0 | rd = 0 | 0x5b
+//
+// in the custom-2 opcode space next to putch (0x0005007f) and halt
+// (0x0000006b). The core and the vector unit execute it as a nop; the
+// harness sees it committed and keeps cycles, stalls and entries per id,
+// reported at exit. Regions with different ids may nest.
+//
+// With roi_select() the other statistics (profile, vector stats, memory
+// trace, waveform) are only collected while roi_active is set.
+#define ROI_OPCODE  0x5b
+#define ROI_NR_IDS  4096
+
+// true while the selected region (or any region for "all") is open; always
+// true when no region was selected
+extern bool roi_active;
+
+// SPEC is a region id or "all"; returns false on a bad spec
+bool roi_select(const char *spec);
+bool roi_selected();
+// forget the open regions, e.g. when the core is reset for a new image
+void roi_reset();
+// open regions and statistics as a flat list of words, so a checkpoint
+// can carry a region that began before it; roi_restore() recomputes
+// roi_active for the current selection and returns false on a bad list
+void roi_save(std::vector<uint64_t> *state);
+bool roi_restore(const std::vector<uint64_t> &state);
+void roi_marker(uint64_t cycle, uint32_t inst);
+void roi_report(uint64_t cycles);
+
+extern uint64_t roi_stall_cycles;
+
+// called before every cycle with the instruction committed in it; returns
+// true when roi_active changed
+static inline bool roi_tick(uint64_t cycle, uint32_t inst, bool stall) {
+  if (stall) {
+    roi_stall_cycles++;
+    return false;
+  }
+  if ((inst & 0x7f) != ROI_OPCODE) return false;
+  bool was_active = roi_active;
+  roi_marker(cycle, inst);
+  return roi_active != was_active;
+}
+
+#endif
@@ -0,0 +1,95 @@
+// sample.cpp
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "sample.h"
+
+// two-sided 95% normal quantile, and the target of the sample size hint
+#define SAMPLE_Z        1.96
+#define SAMPLE_TARGET   0.03
+
+bool sample_on = false;
+
+static uint64_t period, warmup, measure;
+static uint64_t nr_insts = 0;
+static uint64_t window_start;
+// first cycle of the instruction about to commit: the one after the last
+// commit, its stall cycles included
+static uint64_t inst_start;
+static bool started = false;
+static uint64_t detailed_cycles = 0;
+static std::vector<double> cpi;
+
+bool sample_config(const char *spec) {
+  char *end;
+  period = strtoull(spec, &end, 0);
+  bool ok = (*end == ',');
+  if (ok) warmup = strtoull(end + 1, &end, 0);
+  ok = ok && (*end == ',');
+  if (ok) measure = strtoull(end + 1, &end, 0);
+  ok = ok && *end == '\0' && measure > 0 && warmup + measure <= period;
+  if (!ok) {
+    printf("\033[31mERROR: --sample expects PERIOD,WARMUP,MEASURE with WARMUP + MEASURE <= PERIOD: %s\033[0m\n", spec);
+    return false;
+  }
+  sample_on = true;
+  return true;
+}
+
+bool sample_tick(uint64_t cycle, bool stall) {
+  if (!started) {
+    inst_start = cycle;
+    started = true;
+  }
+  uint64_t pos = nr_insts % period;
+  uint64_t fast = period - warmup - measure;
+  // stall cycles only happen while the models run
+  if (stall || pos >= fast) detailed_cycles++;
+  if (stall) return true;
+  // the instruction at pos commits on this cycle
+  nr_insts++;
+  // with MEASURE == PERIOD both happen on the same instruction
+  if (pos == period - measure) window_start = inst_start;
+  if (pos == period - 1) cpi.push_back((double)(cycle + 1 - window_start) / measure);
+  inst_start = cycle + 1;
+  return (pos + 1) % period >= fast;
+}
+
+const std::vector<double> &sample_cpis() {
+  return cpi;
+}
+
+void sample_report(uint64_t cycles) {
+  if (!sample_on) return;
+  printf("\033[34mInterval sampling:\033[0m\n");
+  printf("  period %lu, warm-up %lu, measurement %lu instructions; %lu instructions committed\n",
+         period, warmup, measure, nr_insts);
+  size_t n = cpi.size();
+  if (n == 0) {
+    printf("  no complete measurement window, use a shorter period\n");
+    return;
+  }
+  double mean = 0, var = 0;
+  for (size_t i = 0; i < n; i++) mean += cpi[i];
+  mean /= n;
+  for (size_t i = 0; i < n; i++) var += (cpi[i] - mean) * (cpi[i] - mean);
+  var = n > 1 ? var / (n - 1) : 0;
+  double half = SAMPLE_Z * sqrt(var / n);
+  printf("  %lu samples, CPI %.4f +- %.4f (95%%), coefficient of variation %.3f\n",
+         n, mean, half, mean > 0 ? sqrt(var) / mean : 0.0);
+  printf("  estimated cycles: \033[35m%.0f\033[0m +- %.0f (%.2f%%)\n",
+         mean * nr_insts, half * nr_insts, mean > 0 ? 100.0 * half / mean : 0.0);
+  if (n < 2) {
+    printf("  a single sample has no confidence bound, use a shorter period\n");
+  } else if (half > SAMPLE_TARGET * mean) {
+    // n = (z * V / e)^2, SMARTS eq. 1
+    double cv = sqrt(var) / mean;
+    uint64_t need = (uint64_t)ceil(pow(SAMPLE_Z * cv / SAMPLE_TARGET, 2));
+    printf("  about %lu samples are needed for +-%.0f%%, a period of ~%lu instructions\n",
+           need, 100 * SAMPLE_TARGET, nr_insts / need);
+  }
+  printf("  simulated %lu cycles, %lu of them in detail; cache and DRAM statistics only cover those\n",
+         cycles, detailed_cycles);
+}
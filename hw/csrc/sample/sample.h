@@ -0,0 +1,37 @@
+#ifndef __SAMPLE_H
+#define __SAMPLE_H
+
+#include <cstdint>
+#include <vector>
+
+// -----------------------------------------------------------------------
+// Interval sampling
+// -----------------------------------------------------------------------
+// SMARTS-style systematic sampling of the timing models. The run is cut
+// into periods of PERIOD committed instructions; each period ends with
+//
+//   fast-forward   PERIOD - WARMUP - MEASURE instructions, cache and DRAM
+//                  models off: no stalls, no DPI hooks
+//   warm-up        WARMUP instructions with the models on, not measured,
+//                  so caches, rows and queues hold live state again
+//   measurement    MEASURE instructions, their cycles give one CPI sample
+//
+// The core is single-cycle, so all timing comes from the memory models;
+// skipping them also skips the stall cycles. Architectural state stays
+// live in the model between windows, so no snapshots are needed. At exit
+// total cycles are estimated as committed instructions * mean CPI, with a
+// confidence interval from the spread of the samples.
+
+extern bool sample_on;
+
+// SPEC is PERIOD,WARMUP,MEASURE in instructions; returns false on a bad spec
+bool sample_config(const char *spec);
+// called before every cycle with the memory stall input of the core;
+// returns whether the timing models have to run for the next cycle
+bool sample_tick(uint64_t cycle, bool stall);
+// CPI of every measurement window completed so far
+const std::vector<double> &sample_cpis();
+// estimate and confidence interval; cycles is what the run actually took
+void sample_report(uint64_t cycles);
+
+#endif
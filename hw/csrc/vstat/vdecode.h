@@ -0,0 +1,95 @@
+#ifndef __VDECODE_H
+#define __VDECODE_H
+
+#include <cstdint>
+
+// -----------------------------------------------------------------------
+// Vector instruction decode
+// -----------------------------------------------------------------------
+// C++ mirror of hw/vsrc/vector/v_inst_decode.v: classifies a committed
+// instruction word the same way the vector unit does, without touching
+// the RTL. Header only, so tools outside csrc can include it too.
+
+// VALU_OP_* in v_defines.v
+enum VecAluOp {
+  VALU_NOP, VALU_VADD, VALU_VMUL, VALU_VSUB, VALU_VMIN, VALU_VMAX,
+  VALU_VSRA, VALU_VREDSUM, VALU_VREDMAX, VALU_VMV_V_X, VALU_VDIV,
+  VALU_NR
+};
+
+enum VecKind { VEC_NONE, VEC_ALU, VEC_LOAD, VEC_STORE };
+
+// operand form of an OP-V instruction (funct3)
+// (VFORM_VS: funct3 010 as used by the reductions, and any other funct3)
+enum VecForm { VFORM_VV, VFORM_VX, VFORM_VI, VFORM_VS, VFORM_NR };
+
+#define VDEC_VLMAX        8     // 64-bit elements per 512-bit register
+#define VDEC_LINE_BYTES   64
+
+struct VecOp {
+  VecKind kind;
+  uint8_t alu;       // VecAluOp, VEC_ALU only
+  uint8_t form;      // VecForm, VEC_ALU only
+  bool    indexed;   // vlx / vsx (custom opcodes 0x0b / 0x2b)
+  uint8_t width;     // element width, log2 bytes (vlx/vsx funct3[1:0], 3 otherwise)
+  uint8_t elems;     // elements read or written (active lanes)
+  uint8_t bytes;     // bytes moved by a load/store
+};
+
+static inline VecOp vdecode(uint32_t inst) {
+  VecOp op = { VEC_NONE, VALU_NOP, VFORM_VV, false, 3, 0, 0 };
+  uint32_t opcode = inst & 0x7f;
+  uint32_t funct3 = (inst >> 12) & 0x7;
+  uint32_t funct6 = inst >> 26;
+  switch (opcode) {
+    case 0x57: {   // OP-V
+      op.kind = VEC_ALU;
+      op.form = funct3 == 0 ? VFORM_VV : funct3 == 4 ? VFORM_VX : funct3 == 3 ? VFORM_VI : VFORM_VS;
+      switch (funct6) {
+        case 0x00: op.alu = funct3 == 2 ? VALU_VREDSUM : VALU_VADD; break;
+        case 0x02: op.alu = VALU_VSUB; break;
+        case 0x25: op.alu = VALU_VMUL; break;
+        case 0x21: op.alu = VALU_VDIV; break;
+        case 0x17: op.alu = funct3 == 4 ? VALU_VMV_V_X : VALU_NOP; break;
+        case 0x05: op.alu = VALU_VMIN; break;
+        case 0x07: op.alu = funct3 == 2 ? VALU_VREDMAX : VALU_VMAX; break;
+        case 0x29: op.alu = VALU_VSRA; break;
+        default:   op.alu = VALU_NOP; break;
+      }
+      // vmv.v.x only fills element 0; an unknown funct6 still writes vd
+      // (with zeros) but does no useful work
+      op.elems = op.alu == VALU_VMV_V_X ? 1 : op.alu == VALU_NOP ? 0 : VDEC_VLMAX;
+      break;
+    }
+    case 0x07:     // vle64.v
+    case 0x27:     // vse64.v
+      if (funct3 == 7 && funct6 == 0) {
+        op.kind = opcode == 0x07 ? VEC_LOAD : VEC_STORE;
+        op.elems = VDEC_VLMAX;
+        op.bytes = VDEC_LINE_BYTES;
+      }
+      break;
+    case 0x0b:     // vlx: [31:29] len-1, [14:12] width
+    case 0x2b:     // vsx
+      op.kind = opcode == 0x0b ? VEC_LOAD : VEC_STORE;
+      op.indexed = true;
+      op.width = funct3 & 0x3;
+      // v_mem moves nothing for widths 4..7
+      op.elems = funct3 < 4 ? (inst >> 29) + 1 : 0;
+      op.bytes = op.elems << op.width;
+      break;
+    default:
+      break;
+  }
+  return op;
+}
+
+static inline const char *valu_name(int alu) {
+  static const char *names[VALU_NR] = {
+    "nop", "vadd", "vmul", "vsub", "vmin", "vmax",
+    "vsra", "vredsum", "vredmax", "vmv.v.x", "vdiv",
+  };
+  return names[alu];
+}
+
+#endif
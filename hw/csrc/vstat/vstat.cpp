@@ -0,0 +1,100 @@
+// vstat.cpp
+#include <cstdio>
+
+#include "vdecode.h"
+#include "vstat.h"
+
+// vlx/vsx widths 0..3 plus one bucket for the widths that move nothing
+#define NR_WIDTHS   5
+
+bool vstat_on = false;
+
+static uint64_t retired;
+static uint64_t alu[VALU_NR][VFORM_NR];
+static uint64_t unit[2];                            // vle64, vse64
+static uint64_t indexed[2][NR_WIDTHS][VDEC_VLMAX];  // vlx/vsx by width and len
+static uint64_t lanes, lane_slots;                  // active lanes / 8 per op
+static uint64_t mem_bytes, mem_ops;
+
+void vstat_tick(uint32_t inst) {
+  retired++;
+  VecOp op = vdecode(inst);
+  if (op.kind == VEC_NONE) return;
+  lanes += op.elems;
+  lane_slots += VDEC_VLMAX;
+  if (op.kind == VEC_ALU) {
+    alu[op.alu][op.form]++;
+    return;
+  }
+  int store = op.kind == VEC_STORE;
+  if (op.indexed) {
+    int width = op.elems ? op.width : NR_WIDTHS - 1;
+    indexed[store][width][(inst >> 29) & 0x7]++;
+  } else {
+    unit[store]++;
+  }
+  mem_bytes += op.bytes;
+  mem_ops++;
+}
+
+static double pct(uint64_t x, uint64_t total) {
+  return total ? 100.0 * x / total : 0.0;
+}
+
+static void report_indexed(const char *name, uint64_t (*hist)[VDEC_VLMAX]) {
+  static const char *widths[NR_WIDTHS] = { "8", "16", "32", "64", "inv" };
+  uint64_t total = 0, partial = 0, narrow = 0;
+  for (int w = 0; w < NR_WIDTHS; w++) {
+    for (int l = 0; l < VDEC_VLMAX; l++) {
+      total += hist[w][l];
+      if (l != VDEC_VLMAX - 1) partial += hist[w][l];
+      if (w == 0) narrow += hist[w][l];
+    }
+  }
+  if (!total) return;
+  printf("  %s: %lu, %.1f%% with < 8 elements, %.1f%% 8-bit\n", name, total, pct(partial, total), pct(narrow, total));
+  printf("    %-6s", "width");
+  for (int l = 0; l < VDEC_VLMAX; l++) printf(" %9s%d", "len=", l + 1);
+  printf("\n");
+  for (int w = 0; w < NR_WIDTHS; w++) {
+    uint64_t row = 0;
+    for (int l = 0; l < VDEC_VLMAX; l++) row += hist[w][l];
+    if (!row) continue;
+    printf("    %-6s", widths[w]);
+    for (int l = 0; l < VDEC_VLMAX; l++) printf(" %10lu", hist[w][l]);
+    printf("\n");
+  }
+}
+
+void vstat_report() {
+  if (!vstat_on) return;
+  static const char *forms[VFORM_NR] = { "vv", "vx", "vi", "vs" };
+  uint64_t nr_alu = 0;
+  for (int i = 0; i < VALU_NR; i++)
+    for (int f = 0; f < VFORM_NR; f++) nr_alu += alu[i][f];
+  uint64_t nr_vec = nr_alu + mem_ops;
+
+  printf("\033[34mVector instruction mix:\033[0m\n");
+  printf("  retired: %lu, scalar: %lu, vector: %lu (%.2f%%), ALU %lu, load/store %lu\n",
+         retired, retired - nr_vec, nr_vec, pct(nr_vec, retired), nr_alu, mem_ops);
+  if (!nr_vec) return;
+  printf("  %-10s", "op");
+  for (int f = 0; f < VFORM_NR; f++) printf(" %12s", forms[f]);
+  printf(" %8s\n", "share");
+  for (int i = 0; i < VALU_NR; i++) {
+    uint64_t n = 0;
+    for (int f = 0; f < VFORM_NR; f++) n += alu[i][f];
+    if (!n) continue;
+    printf("  %-10s", valu_name(i));
+    for (int f = 0; f < VFORM_NR; f++) printf(" %12lu", alu[i][f]);
+    printf(" %7.2f%%\n", pct(n, nr_vec));
+  }
+  if (unit[0]) printf("  %-10s %12lu %38s %7.2f%%\n", "vle64", unit[0], "", pct(unit[0], nr_vec));
+  if (unit[1]) printf("  %-10s %12lu %38s %7.2f%%\n", "vse64", unit[1], "", pct(unit[1], nr_vec));
+  report_indexed("vlx", indexed[0]);
+  report_indexed("vsx", indexed[1]);
+  printf("  active lanes: %.1f%% of %lu lane slots\n", pct(lanes, lane_slots), lane_slots);
+  if (mem_ops)
+    printf("  load/store port: %lu of %lu bytes used (%.1f%% of the 512-bit datapath)\n",
+           mem_bytes, mem_ops * VDEC_LINE_BYTES, pct(mem_bytes, mem_ops * VDEC_LINE_BYTES));
+}
@@ -0,0 +1,22 @@
+#ifndef __VSTAT_H
+#define __VSTAT_H
+
+#include <cstdint>
+
+// -----------------------------------------------------------------------
+// Vector instruction-mix statistics
+// -----------------------------------------------------------------------
+// Decodes every committed instruction with vdecode.h and counts the vector
+// ops the vector unit executes: VALU_OP_* class and operand form, vle64 /
+// vse64, and vlx / vsx by element width and length. Each op also adds its
+// active lanes (out of 8) and, for loads and stores, the bytes it moves
+// over the 512-bit port, which vstat_report() turns into the fraction of
+// the vector datapath the program actually uses.
+extern bool vstat_on;
+
+// called before every cycle with the instruction committed in it; stall
+// cycles (the core sees a nop) must not be passed in
+void vstat_tick(uint32_t inst);
+void vstat_report();
+
+#endif
@@ -0,0 +1,77 @@
+// vtrace.cpp
+#include <cstdio>
+#include <cstring>
+#include <zlib.h>
+
+#include "config.h"
+#include "ram.h"
+#include "vdecode.h"
+#include "vtrace.h"
+
+bool vtrace_on = false;
+
+static gzFile trace;
+static uint64_t nr_records = 0, nr_lines = 0, gap = 0;
+// a store is only visible in RAM after its clock edge, so its line is
+// written out at the next tick (or at close)
+static bool store_pending = false;
+static uint64_t store_idx;
+
+static void write_line(uint64_t idx) {
+  const uint64_t *ram = get_ram_start();
+  const uint64_t nr_words = EMU_RAM_SIZE / sizeof(uint64_t);
+  uint64_t line[EMU_VLINE_WORDS];
+  for (int i = 0; i < EMU_VLINE_WORDS; i++) line[i] = ram[(idx + i) % nr_words];
+  gzwrite(trace, line, sizeof(line));
+  nr_lines++;
+}
+
+bool vtrace_open(const char *path) {
+  trace = gzopen(path, "wb1");
+  if (trace == NULL) {
+    printf("\033[31mERROR: Can not create vector trace %s\033[0m\n", path);
+    return false;
+  }
+  uint64_t magic = VTRACE_MAGIC;
+  gzwrite(trace, &magic, sizeof(magic));
+  vtrace_on = true;
+  return true;
+}
+
+void vtrace_close() {
+  if (!vtrace_on) return;
+  if (store_pending) write_line(store_idx);
+  VecTraceRecord end = { 0, VTRACE_END, 0, 0, gap };
+  gzwrite(trace, &end, sizeof(end));
+  gzclose(trace);
+  vtrace_on = false;
+  printf("\033[34mVector trace: %lu instructions, %lu memory lines\033[0m\n", nr_records, nr_lines);
+}
+
+void vtrace_tick(uint32_t inst, uint64_t rs1) {
+  if (store_pending) {
+    write_line(store_idx);
+    store_pending = false;
+  }
+  VecOp op = vdecode(inst);
+  if (op.kind == VEC_NONE) {
+    gap++;
+    return;
+  }
+  VecTraceRecord r = { inst, 0, rs1, 0, gap };
+  gap = 0;
+  if (op.kind == VEC_LOAD || op.kind == VEC_STORE) {
+    // v_mem: rs1 (+ sext(inst[28:21]) for vlx/vsx), on a 64-bit boundary
+    uint64_t addr = rs1;
+    if (op.indexed) addr += (int64_t)(int8_t)(inst >> 21);
+    r.idx = (addr - 0x80000000UL) >> 3;
+    r.flags = op.kind == VEC_LOAD ? VTRACE_LOAD : VTRACE_STORE;
+  }
+  gzwrite(trace, &r, sizeof(r));
+  nr_records++;
+  if (r.flags == VTRACE_LOAD) write_line(r.idx);
+  if (r.flags == VTRACE_STORE) {
+    store_pending = true;
+    store_idx = r.idx;
+  }
+}
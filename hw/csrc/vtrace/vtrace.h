@@ -0,0 +1,41 @@
+#ifndef __VTRACE_H
+#define __VTRACE_H
+
+#include <cstdint>
+
+// -----------------------------------------------------------------------
+// Vector instruction trace
+// -----------------------------------------------------------------------
+// Records the stream of committed vector instructions (vdecode.h) of an
+// emu run, with what the vector unit takes from outside v_rvcpu: the rs1
+// value of the scalar core and the memory lines it reads. hw/vtb replays
+// it on v_rvcpu alone. gzip stream, the 8-byte magic "EMUVTRC1", then per
+// instruction one VecTraceRecord, followed by the 64-byte line for loads
+// (as read) and stores (after the store, for checking the replay). A last
+// VTRACE_END record carries the scalar instructions after the final vector
+// one, so the gaps add up to all scalar instructions of the run
+// (hw/tools/vdse.cpp models whole-program cycles from them).
+#define VTRACE_MAGIC      0x3143525456554d45UL  // "EMUVTRC1"
+
+#define VTRACE_LOAD       0x1
+#define VTRACE_STORE      0x2
+#define VTRACE_END        0x4
+#define VTRACE_LINE_BYTES 64
+
+struct VecTraceRecord {
+  uint32_t inst;
+  uint32_t flags;
+  uint64_t rs1;      // x[inst[19:15]] as the vector unit saw it
+  uint64_t idx;      // RAM word index of the line, loads and stores only
+  uint64_t gap;      // scalar instructions committed since the last record
+};
+
+extern bool vtrace_on;
+
+bool vtrace_open(const char *path);
+void vtrace_close();
+// called before every cycle that commits an instruction, with the rs1
+// value top exports for the vector unit
+void vtrace_tick(uint32_t inst, uint64_t rs1);
+
+#endif
@@ -0,0 +1,460 @@
+// iss.cpp
+// Fast functional instruction-set simulator for the mycpu platform.
+//
+// Executes the same images as build/emu, instruction by instruction and
+// without timing: RV64I plus mul as decoded by rvcpu, the putch/halt words
+// from trm.c, and the custom vector instructions exactly as
+// v_inst_decode.v, v_execute.v and v_mem.v define them (512-bit registers
+// of 8 x 64-bit elements, v0 never written, 512-bit memory port on a
+// 64-bit aligned address). Corner cases follow the RTL rather than the
+// ISA manual where they differ: register shift amounts are not masked,
+// jalr does not clear bit 0, srlw/srliw results are not sign-extended,
+// instructions the core does not decode are nops.
+//
+// Memory is the RAM model of the emulator (hw/csrc/ram/ram.cpp), so
+// images, the data window at ADDR_DATA and the save file behave the same,
+// and loads from the hpm.v counter page return the functional equivalent
+// of the hardware counters (one instruction per cycle, no stalls). ROI
+// markers are counted like in emu.
+//
+//   make iss
+//   ./hw/build/iss [options] <inst.bin|inst.elf> <data.bin> <save.bin> <sim_time> <half_cycle>
+#include <getopt.h>
+#include <chrono>
+
+#include "config.h"
+#include "ram.h"
+#include "roi.h"
+#include "vdecode.h"
+#include "vstat.h"
+
+#define ADDR_BASE     0x80000000UL
+#define ADDR_DATA     0x80800000UL
+#define HPM_PAGE      0xa0000UL       // hpm.v window, 0xa0000000 >> 12
+
+#define INST_HALT     0x0000006b
+#define INST_PUTCH    0x0005007f
+
+static const uint64_t ram_mask = EMU_RAM_SIZE - 1;
+static const uint64_t nr_words = EMU_RAM_SIZE / sizeof(uint64_t);
+
+static uint8_t *mem;
+static uint8_t *dirty;
+
+static uint64_t x[32];
+static uint64_t v[32][VDEC_VLMAX];
+static uint64_t pc = FIRST_INST_ADDRESS;
+static uint64_t nr_insts = 0;
+
+// hpm.v counters that do not follow from nr_insts
+enum { HPM_VALU = 3, HPM_VLOAD, HPM_VSTORE, HPM_VLOAD_BYTES, HPM_VSTORE_BYTES, HPM_VMEM_ELEMS, HPM_NR };
+static uint64_t hpm[HPM_NR];
+
+static inline int64_t sext(uint64_t val, int bits) {
+  return (int64_t)(val << (64 - bits)) >> (64 - bits);
+}
+
+// -----------------------------------------------------------------------
+// Memory, word granular like the RAM helpers
+// -----------------------------------------------------------------------
+static inline uint64_t *word_ptr(uint64_t idx) {
+  return (uint64_t *)mem + idx;
+}
+
+// the 64-bit word holding addr; reads wrap around the end of RAM
+static inline uint64_t load_word(uint64_t addr) {
+  if ((addr >> 12) == HPM_PAGE) {
+    uint64_t n = (addr >> 3) & 0x1ff;
+    if (n == 0 || n == 1) return nr_insts;   // cycle, instret
+    return n < HPM_NR ? hpm[n] : 0;
+  }
+  return *word_ptr(((addr - ADDR_BASE) >> 3) & (nr_words - 1));
+}
+
+static inline void store(uint64_t addr, uint64_t data, int size) {
+  if ((addr >> 12) == HPM_PAGE) return;
+  uint64_t idx = (addr - ADDR_BASE) >> 3;
+  if (idx >= nr_words) {
+    printf("ERROR: ram wIdx = 0x%lx out of bound! (pc = 0x%lx)\n", idx, pc);
+    exit(1);
+  }
+  int shift = addr & 7;
+  if (size > 8 - shift) size = 8 - shift;
+  memcpy((uint8_t *)word_ptr(idx) + shift, &data, size);
+  dirty[idx >> (EMU_PAGE_SHIFT - 3)] = 1;
+}
+
+static inline void load_line(uint64_t addr, uint64_t *line) {
+  uint64_t idx = (addr - ADDR_BASE) >> 3;
+  for (int i = 0; i < VDEC_VLMAX; i++) line[i] = *word_ptr((idx + i) & (nr_words - 1));
+}
+
+static inline void store_line(uint64_t addr, const uint64_t *line, const uint64_t *mask) {
+  uint64_t idx = (addr - ADDR_BASE) >> 3;
+  if (idx > nr_words - VDEC_VLMAX) {
+    printf("ERROR: vram wIdx = 0x%lx out of bound! (pc = 0x%lx)\n", idx, pc);
+    exit(1);
+  }
+  for (int i = 0; i < VDEC_VLMAX; i++) {
+    uint64_t *p = word_ptr(idx + i);
+    *p = (*p & ~mask[i]) | (line[i] & mask[i]);
+  }
+  dirty[idx >> (EMU_PAGE_SHIFT - 3)] = 1;
+  dirty[(idx + VDEC_VLMAX - 1) >> (EMU_PAGE_SHIFT - 3)] = 1;
+}
+
+// -----------------------------------------------------------------------
+// Vector unit
+// -----------------------------------------------------------------------
+static void exec_valu(uint32_t inst, const VecOp &op) {
+  uint32_t vd = (inst >> 7) & 0x1f;
+  uint32_t funct3 = (inst >> 12) & 0x7;
+  uint32_t rs1 = (inst >> 15) & 0x1f;
+  const uint64_t *v2 = v[(inst >> 20) & 0x1f];
+
+  // operand_v1 as v_inst_decode builds it for this funct6/funct3
+  uint64_t v1[VDEC_VLMAX] = { 0 };
+  switch (funct3) {
+    case 0:   // vv
+      memcpy(v1, v[rs1], sizeof(v1));
+      break;
+    case 4:   // vx; vmv.v.x only fills element 0
+      for (int i = 0; i < VDEC_VLMAX; i++) v1[i] = x[rs1];
+      if (op.alu == VALU_VMV_V_X) memset(v1 + 1, 0, sizeof(v1) - sizeof(v1[0]));
+      break;
+    case 3:   // vi, only vadd and vsra take the immediate
+      if (op.alu == VALU_VADD || op.alu == VALU_VSRA)
+        for (int i = 0; i < VDEC_VLMAX; i++) v1[i] = sext(rs1, 5);
+      break;
+    case 2:   // vredsum.vs / vredmax.vs
+      if (op.alu == VALU_VREDSUM || op.alu == VALU_VREDMAX) memcpy(v1, v[rs1], sizeof(v1));
+      break;
+  }
+
+  uint64_t res[VDEC_VLMAX] = { 0 };
+  switch (op.alu) {
+    case VALU_VADD:
+      for (int i = 0; i < VDEC_VLMAX; i++) res[i] = v2[i] + v1[i];
+      break;
+    case VALU_VSUB:
+      for (int i = 0; i < VDEC_VLMAX; i++) res[i] = v2[i] - v1[i];
+      break;
+    case VALU_VMUL:
+      for (int i = 0; i < VDEC_VLMAX; i++) res[i] = v2[i] * v1[i];
+      break;
+    case VALU_VDIV:
+      // Verilator: x / 0 = 0 and INT64_MIN / -1 = INT64_MIN
+      for (int i = 0; i < VDEC_VLMAX; i++) {
+        if (v1[i] == 0) res[i] = 0;
+        else if (v1[i] == ~0UL) res[i] = -v2[i];
+        else res[i] = (int64_t)v2[i] / (int64_t)v1[i];
+      }
+      break;
+    case VALU_VMIN:
+      for (int i = 0; i < VDEC_VLMAX; i++) res[i] = (int64_t)v2[i] < (int64_t)v1[i] ? v2[i] : v1[i];
+      break;
+    case VALU_VMAX:
+      for (int i = 0; i < VDEC_VLMAX; i++) res[i] = (int64_t)v2[i] > (int64_t)v1[i] ? v2[i] : v1[i];
+      break;
+    case VALU_VSRA:
+      for (int i = 0; i < VDEC_VLMAX; i++) res[i] = (int64_t)v2[i] >> (v1[i] & 0x1f);
+      break;
+    case VALU_VREDSUM:
+      res[0] = v1[0];
+      for (int i = 0; i < VDEC_VLMAX; i++) res[0] += v2[i];
+      break;
+    case VALU_VREDMAX: {
+      // the maximum over all of vs2 and all of vs1
+      int64_t m = v2[0];
+      for (int i = 1; i < VDEC_VLMAX; i++) if ((int64_t)v2[i] > m) m = v2[i];
+      for (int i = 0; i < VDEC_VLMAX; i++) if ((int64_t)v1[i] > m) m = v1[i];
+      res[0] = m;
+      break;
+    }
+    case VALU_VMV_V_X:
+      memcpy(res, v1, sizeof(res));
+      break;
+    default:  // nop: vd is still written, with zeros
+      break;
+  }
+  if (vd != 0) memcpy(v[vd], res, sizeof(res));
+  hpm[HPM_VALU]++;
+}
+
+static void exec_vmem(uint32_t inst, const VecOp &op) {
+  uint32_t vd = (inst >> 7) & 0x1f;
+  uint64_t addr = x[(inst >> 15) & 0x1f];
+  if (op.indexed) addr += sext(inst >> 21, 8);
+  int size = 1 << op.width;
+
+  if (op.kind == VEC_LOAD) {
+    uint64_t line[VDEC_VLMAX];
+    load_line(addr, line);
+    uint64_t res[VDEC_VLMAX] = { 0 };
+    if (!op.indexed) {
+      memcpy(res, line, sizeof(res));
+    } else {
+      // elements packed at the line start (the low address bits are
+      // dropped), zero- or sign-extended by bit 20
+      const uint8_t *bytes = (const uint8_t *)line;
+      bool sign = (inst >> 20) & 1;
+      for (int i = 0; i < op.elems; i++) {
+        uint64_t e = 0;
+        memcpy(&e, bytes + i * size, size);
+        res[i] = (sign && size < 8) ? sext(e, size * 8) : e;
+      }
+    }
+    if (vd != 0) memcpy(v[vd], res, sizeof(res));
+    hpm[HPM_VLOAD]++;
+    hpm[HPM_VLOAD_BYTES] += op.bytes;
+  } else {
+    uint64_t line[VDEC_VLMAX] = { 0 }, mask[VDEC_VLMAX] = { 0 };
+    if (!op.indexed) {
+      memcpy(line, v[vd], sizeof(line));   // vs3 in the vd field
+      memset(mask, 0xff, sizeof(mask));
+    } else {
+      const uint64_t *vs3 = v[(inst >> 20) & 0x1f];
+      for (int i = 0; i < op.elems; i++) {
+        memcpy((uint8_t *)line + i * size, &vs3[i], size);
+        memset((uint8_t *)mask + i * size, 0xff, size);
+      }
+    }
+    store_line(addr, line, mask);
+    hpm[HPM_VSTORE]++;
+    hpm[HPM_VSTORE_BYTES] += op.bytes;
+  }
+  hpm[HPM_VMEM_ELEMS] += op.elems;
+}
+
+// -----------------------------------------------------------------------
+// Scalar core
+// -----------------------------------------------------------------------
+enum { RUN_LIMIT, RUN_HALT };
+
+static int run(uint64_t max_insts) {
+  while (nr_insts < max_insts) {
+    uint32_t inst = *(uint32_t *)(mem + (((pc - ADDR_BASE) & ram_mask) & ~3UL));
+    if (vstat_on && roi_active) vstat_tick(inst);
+    uint32_t rd = (inst >> 7) & 0x1f;
+    uint32_t funct3 = (inst >> 12) & 0x7;
+    uint64_t a = x[(inst >> 15) & 0x1f];
+    uint64_t b = x[(inst >> 20) & 0x1f];
+    uint32_t funct7 = inst >> 25;
+    int64_t imm_i = (int32_t)inst >> 20;
+    uint64_t next = pc + 4;
+
+    switch (inst & 0x7f) {
+      case 0x37:  // lui
+        x[rd] = (int64_t)(int32_t)(inst & 0xfffff000);
+        break;
+      case 0x17:  // auipc
+        x[rd] = pc + (int64_t)(int32_t)(inst & 0xfffff000);
+        break;
+      case 0x6f: {  // jal
+        int64_t imm = ((int64_t)(int32_t)(inst & 0x80000000) >> 11) | (inst & 0xff000) |
+                      ((inst >> 9) & 0x800) | ((inst >> 20) & 0x7fe);
+        x[rd] = pc + 4;
+        next = pc + imm;
+        break;
+      }
+      case 0x67:  // jalr, target not masked to even
+        if (funct3 != 0) break;
+        next = a + imm_i;
+        x[rd] = pc + 4;
+        break;
+      case 0x63: {  // branches
+        int64_t imm = ((int64_t)(int32_t)(inst & 0x80000000) >> 19) | ((inst << 4) & 0x800) |
+                      ((inst >> 20) & 0x7e0) | ((inst >> 7) & 0x1e);
+        bool taken;
+        switch (funct3) {
+          case 0: taken = a == b; break;
+          case 1: taken = a != b; break;
+          case 4: taken = (int64_t)a < (int64_t)b; break;
+          case 5: taken = (int64_t)a >= (int64_t)b; break;
+          case 6: taken = a < b; break;
+          case 7: taken = a >= b; break;
+          default: taken = false; break;
+        }
+        if (taken) next = pc + imm;
+        break;
+      }
+      case 0x03: {  // loads
+        uint64_t addr = a + imm_i;
+        uint64_t w = load_word(addr) >> ((addr & 7) * 8);
+        switch (funct3) {
+          case 0: x[rd] = (int8_t)w; break;
+          case 1: x[rd] = (int16_t)w; break;
+          case 2: x[rd] = (int32_t)w; break;
+          case 3: x[rd] = w; break;
+          case 4: x[rd] = (uint8_t)w; break;
+          case 5: x[rd] = (uint16_t)w; break;
+          case 6: x[rd] = (uint32_t)w; break;
+          default: break;
+        }
+        break;
+      }
+      case 0x23: {  // stores
+        int64_t imm = ((int32_t)inst >> 25 << 5) | rd;
+        if (funct3 <= 3) store(a + imm, b, 1 << funct3);
+        break;
+      }
+      case 0x13: {  // op-imm
+        uint32_t shamt = (inst >> 20) & 0x3f;
+        switch (funct3) {
+          case 0: x[rd] = a + imm_i; break;
+          case 2: x[rd] = (int64_t)a < imm_i; break;
+          case 3: x[rd] = a < (uint64_t)imm_i; break;
+          case 4: x[rd] = a ^ imm_i; break;
+          case 6: x[rd] = a | imm_i; break;
+          case 7: x[rd] = a & imm_i; break;
+          case 1: if ((funct7 >> 1) == 0) x[rd] = a << shamt; break;
+          case 5:
+            if ((funct7 >> 1) == 0) x[rd] = a >> shamt;
+            else if ((funct7 >> 1) == 0x10) x[rd] = (int64_t)a >> shamt;
+            break;
+        }
+        break;
+      }
+      case 0x33:  // op
+        if (funct7 == 0x01) {
+          if (funct3 == 0) x[rd] = a * b;   // mul only
+          break;
+        }
+        if (funct7 != 0 && !(funct7 == 0x20 && (funct3 == 0 || funct3 == 5))) break;
+        switch (funct3) {
+          case 0: x[rd] = funct7 ? a - b : a + b; break;
+          case 1: x[rd] = b < 64 ? a << b : 0; break;
+          case 2: x[rd] = (int64_t)a < (int64_t)b; break;
+          case 3: x[rd] = a < b; break;
+          case 4: x[rd] = a ^ b; break;
+          case 5:
+            if (funct7) x[rd] = (int64_t)a >> (b < 64 ? b : 63);
+            else x[rd] = b < 64 ? a >> b : 0;
+            break;
+          case 6: x[rd] = a | b; break;
+          case 7: x[rd] = a & b; break;
+        }
+        break;
+      case 0x1b: {  // op-imm-32
+        uint32_t shamt = (inst >> 20) & 0x3f;
+        if (funct3 == 0) x[rd] = (int32_t)(a + imm_i);
+        else if (funct3 == 1 && funct7 == 0) x[rd] = (int32_t)((uint32_t)a << shamt);
+        else if (funct3 == 5 && funct7 == 0) x[rd] = (uint64_t)(uint32_t)a >> shamt;
+        else if (funct3 == 5 && funct7 == 0x20) x[rd] = (int64_t)(int32_t)a >> shamt;
+        break;
+      }
+      case 0x3b: {  // op-32
+        uint32_t sh = b & 0x1f;
+        if (funct3 == 0 && funct7 == 0) x[rd] = (int32_t)(a + b);
+        else if (funct3 == 0 && funct7 == 0x20) x[rd] = (int32_t)(a - b);
+        else if (funct3 == 1 && funct7 == 0) x[rd] = b < 64 ? (int32_t)(a << b) : 0;
+        else if (funct3 == 5 && funct7 == 0) x[rd] = (uint64_t)(uint32_t)a >> sh;
+        else if (funct3 == 5 && funct7 == 0x20) x[rd] = (int64_t)(int32_t)a >> sh;
+        break;
+      }
+      case 0x57:  // OP-V
+        exec_valu(inst, vdecode(inst));
+        break;
+      case 0x07: case 0x27: case 0x0b: case 0x2b: {  // vle64/vse64/vlx/vsx
+        VecOp op = vdecode(inst);
+        if (op.kind != VEC_NONE) exec_vmem(inst, op);
+        break;
+      }
+      case 0x5b:  // ROI marker
+        roi_tick(nr_insts, inst, false);
+        break;
+      case 0x7f:
+        if (inst == INST_PUTCH) putchar((char)x[10]);
+        break;
+      case 0x6b:
+        if (inst == INST_HALT) {
+          printf("\n\033[31mHALT-%u\n\033[0m", (uint32_t)x[10]);
+          nr_insts++;
+          return RUN_HALT;
+        }
+        break;
+      default:  // not decoded by the core: nop
+        break;
+    }
+    x[0] = 0;
+    pc = next;
+    nr_insts++;
+  }
+  return RUN_LIMIT;
+}
+
+static void print_usage(const char *prog) {
+  printf("Usage: %s [options] <inst.bin|inst.elf> <data.bin> <save.bin> <sim_time> <half_cycle>\n", prog);
+  printf("Runs at most sim_time / (2 * half_cycle) instructions, like the cycle limit of emu.\n");
+  printf("Options:\n");
+  printf("  --save-window=ADDR:LEN  only save [ADDR, ADDR+LEN) (repeatable)\n");
+  printf("  --save-flat           save a flat dump from ADDR_DATA to the end of RAM\n");
+  printf("  --vec-stats           report the vector instruction mix and lane utilization\n");
+  printf("  --roi=ID|all          count instructions inside ROI_BEGIN/ROI_END markers\n");
+}
+
+int main(int argc, char **argv) {
+  static const struct option long_options[] = {
+    { "save-window", required_argument, NULL, 'w' },
+    { "save-flat",   no_argument,       NULL, 'F' },
+    { "vec-stats",   no_argument,       NULL, 'V' },
+    { "roi",         required_argument, NULL, 'O' },
+    { "help",        no_argument,       NULL, 'h' },
+    { 0,             0,                 NULL,  0  }
+  };
+  int o;
+  while ((o = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+    switch (o) {
+      case 'w': {
+        char *end;
+        uint64_t addr = strtoull(optarg, &end, 0);
+        if (*end != ':') {
+          printf("\033[31mERROR: --save-window expects ADDR:LEN\033[0m\n");
+          return 1;
+        }
+        ram_add_save_window(addr, strtoull(end + 1, NULL, 0));
+        break;
+      }
+      case 'F': ram_save_flat(true); break;
+      case 'V': vstat_on = true; break;
+      case 'O': if (!roi_select(optarg)) return 1; break;
+      case 'h': print_usage(argv[0]); return 0;
+      default : print_usage(argv[0]); return 1;
+    }
+  }
+  if (argc - optind != 5) {
+    print_usage(argv[0]);
+    return 1;
+  }
+  const char *path_inst = argv[optind];
+  const char *path_data = argv[optind + 1];
+  const char *path_save = argv[optind + 2];
+  uint64_t max_insts = strtoull(argv[optind + 3], NULL, 0) / (2 * strtoull(argv[optind + 4], NULL, 0));
+
+  init_ram(path_inst);
+  load_data(ADDR_DATA, path_data);
+  mem = (uint8_t *)get_ram_start();
+  dirty = get_ram_dirty_map();
+
+  printf("\033[34mThe program is running now......\033[0m\n");
+  printf("----------------------------------------------------------\n");
+  auto start = std::chrono::steady_clock::now();
+  int result = run(max_insts);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  fflush(stdout);
+
+  printf("\n----------------------------------------------------------\n");
+  printf("\033[34mThe program finished after \033[35m%ld\033[34m instructions.\033[0m \n", nr_insts);
+  if (result != RUN_HALT) {
+    printf("\033[31mThe sim time is too short !!!\033[0m\n");
+  }
+  roi_report(nr_insts);
+  vstat_report();
+  printf("\033[34mSimulation speed: \033[35m%.0f\033[34m instructions/s (%.3f s)\033[0m\n",
+         seconds > 0 ? nr_insts / seconds : 0.0, seconds);
+
+  printf("Save the data into file %s\n", path_save);
+  save_data(ADDR_DATA, path_save);
+  ram_finish();
+  return 0;
+}
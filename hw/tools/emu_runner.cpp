@@ -0,0 +1,258 @@
+// emu_runner.cpp
+// Parallel regression runner for the emulator.
+//
+// Reads a job list with one emulator run per line:
+//
+//   NAME INST.bin DATA.bin SAVE.bin [emu options...]
+//
+// and keeps up to N emu processes running at once, each with its own log
+// file. Jobs that run longer than the timeout are killed. When all jobs are
+// done the exit code, cycle count, HALT code and save file of every job are
+// printed as one table. The runner exits with 1 if any job did not halt
+// with code 0.
+//
+//   g++ -O2 -std=c++11 hw/tools/emu_runner.cpp -o emu_runner
+//   ./emu_runner [-j N] [-t SEC] [-e EMU] [-T SIM_TIME] [-c HALF_CYCLE] [-o LOGDIR] JOBS
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <chrono>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// emu exit code for a run stopped by the hang watchdog (EXIT_HANG in main.cpp)
+#define EMU_EXIT_HANG 3
+
+enum JobState { JOB_PENDING, JOB_RUNNING, JOB_DONE };
+
+struct Job {
+  string name, inst, data, save;
+  vector<string> emu_args;
+  string log;
+  JobState state = JOB_PENDING;
+  pid_t pid = -1;
+  chrono::steady_clock::time_point start;
+  double seconds = 0;
+  bool timed_out = false;
+  int wait_status = 0;
+  long cycles = -1;     // "finished after N cycles", -1 if missing
+  long halt = -1;       // "HALT-N", -1 if the program never halted
+};
+
+static string emu_path = "./hw/build/emu";
+static string log_dir = "./hw/build/regress";
+static string sim_time = "1000000000";
+static string half_cycle = "1";
+static int nr_workers = 0;
+static double timeout_sec = 600;
+
+static vector<Job> read_jobs(const char *path) {
+  ifstream in(path);
+  if (!in) {
+    printf("\033[31mERROR: Can not open job list %s\033[0m\n", path);
+    exit(2);
+  }
+  vector<Job> jobs;
+  string line;
+  while (getline(in, line)) {
+    istringstream fields(line);
+    Job job;
+    if (!(fields >> job.name) || job.name[0] == '#') continue;
+    if (!(fields >> job.inst >> job.data >> job.save)) {
+      printf("\033[31mERROR: job '%s' needs NAME INST DATA SAVE\033[0m\n", job.name.c_str());
+      exit(2);
+    }
+    string arg;
+    while (fields >> arg) job.emu_args.push_back(arg);
+    job.log = log_dir + "/" + job.name + ".log";
+    jobs.push_back(job);
+  }
+  return jobs;
+}
+
+static void start_job(Job &job) {
+  vector<string> args;
+  args.push_back(emu_path);
+  args.insert(args.end(), job.emu_args.begin(), job.emu_args.end());
+  args.push_back(job.inst);
+  args.push_back(job.data);
+  args.push_back(job.save);
+  args.push_back(sim_time);
+  args.push_back(half_cycle);
+
+  job.start = chrono::steady_clock::now();
+  job.pid = fork();
+  if (job.pid < 0) {
+    perror("fork");
+    exit(2);
+  }
+  if (job.pid == 0) {
+    int fd = open(job.log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) _exit(127);
+    dup2(fd, STDOUT_FILENO);
+    dup2(fd, STDERR_FILENO);
+    close(fd);
+    // own process group, so a timeout also takes down anything emu spawned
+    setpgid(0, 0);
+    vector<char *> argv;
+    for (size_t i = 0; i < args.size(); i++) argv.push_back(const_cast<char *>(args[i].c_str()));
+    argv.push_back(NULL);
+    execv(argv[0], argv.data());
+    fprintf(stderr, "Can not exec %s: %s\n", argv[0], strerror(errno));
+    _exit(127);
+  }
+  job.state = JOB_RUNNING;
+  printf("\033[34m[start]\033[0m %s\n", job.name.c_str());
+  fflush(stdout);
+}
+
+// read the number that follows `key` in the log, skipping ANSI color codes
+static long find_number(const string &log, const char *key) {
+  size_t pos = log.rfind(key);
+  if (pos == string::npos) return -1;
+  pos += strlen(key);
+  while (pos < log.size() && !isdigit((unsigned char)log[pos])) {
+    if (log[pos] == '\033') {
+      while (pos < log.size() && log[pos] != 'm') pos++;
+    } else if (log[pos] != ' ' && log[pos] != '-') {
+      return -1;
+    }
+    pos++;
+  }
+  if (pos >= log.size()) return -1;
+  return strtol(log.c_str() + pos, NULL, 10);
+}
+
+static void finish_job(Job &job, int status) {
+  job.state = JOB_DONE;
+  job.wait_status = status;
+  job.seconds = chrono::duration<double>(chrono::steady_clock::now() - job.start).count();
+  ifstream in(job.log.c_str());
+  stringstream buf;
+  buf << in.rdbuf();
+  string log = buf.str();
+  job.cycles = find_number(log, "finished after");
+  job.halt = find_number(log, "HALT");
+}
+
+static const char *job_status(const Job &job) {
+  if (job.timed_out) return "TIMEOUT";
+  if (WIFSIGNALED(job.wait_status)) return "CRASH";
+  if (WEXITSTATUS(job.wait_status) == EMU_EXIT_HANG) return "HANG";
+  if (WEXITSTATUS(job.wait_status) != 0) return "ERROR";
+  if (job.halt < 0) return "NO-HALT";
+  return job.halt == 0 ? "PASS" : "FAIL";
+}
+
+static void print_usage(const char *prog) {
+  printf("Usage: %s [options] JOBS\n", prog);
+  printf("JOBS lists one run per line: NAME INST.bin DATA.bin SAVE.bin [emu options...]\n");
+  printf("Options:\n");
+  printf("  -j N          number of parallel emu processes (default: host cores)\n");
+  printf("  -t SEC        per-job timeout in seconds (default: %.0f, 0 = none)\n", timeout_sec);
+  printf("  -e EMU        emulator binary (default: %s)\n", emu_path.c_str());
+  printf("  -T SIM_TIME   sim_time passed to every job (default: %s)\n", sim_time.c_str());
+  printf("  -c HALF_CYCLE half_cycle passed to every job (default: %s)\n", half_cycle.c_str());
+  printf("  -o LOGDIR     directory for the per-job logs (default: %s)\n", log_dir.c_str());
+}
+
+int main(int argc, char **argv) {
+  int o;
+  while ((o = getopt(argc, argv, "j:t:e:T:c:o:h")) != -1) {
+    switch (o) {
+      case 'j': nr_workers = atoi(optarg); break;
+      case 't': timeout_sec = atof(optarg); break;
+      case 'e': emu_path = optarg; break;
+      case 'T': sim_time = optarg; break;
+      case 'c': half_cycle = optarg; break;
+      case 'o': log_dir = optarg; break;
+      case 'h': print_usage(argv[0]); return 0;
+      default : print_usage(argv[0]); return 2;
+    }
+  }
+  if (optind != argc - 1) {
+    print_usage(argv[0]);
+    return 2;
+  }
+  if (nr_workers <= 0) {
+    nr_workers = thread::hardware_concurrency();
+    if (nr_workers <= 0) nr_workers = 1;
+  }
+  mkdir(log_dir.c_str(), 0755);
+
+  vector<Job> jobs = read_jobs(argv[optind]);
+  printf("Running %zu job(s) on %d worker(s), logs in %s\n", jobs.size(), nr_workers, log_dir.c_str());
+  auto sweep_start = chrono::steady_clock::now();
+
+  size_t next = 0, nr_done = 0;
+  int nr_running = 0;
+  while (nr_done < jobs.size()) {
+    while (nr_running < nr_workers && next < jobs.size()) {
+      start_job(jobs[next++]);
+      nr_running++;
+    }
+
+    int status;
+    pid_t pid = waitpid(-1, &status, WNOHANG);
+    if (pid > 0) {
+      for (size_t i = 0; i < jobs.size(); i++) {
+        if (jobs[i].state == JOB_RUNNING && jobs[i].pid == pid) {
+          finish_job(jobs[i], status);
+          printf("\033[34m[%s]\033[0m %s\n", job_status(jobs[i]), jobs[i].name.c_str());
+          fflush(stdout);
+          nr_running--;
+          nr_done++;
+          break;
+        }
+      }
+      continue;
+    }
+
+    // nothing exited: enforce the timeouts, then sleep a little
+    auto now = chrono::steady_clock::now();
+    for (size_t i = 0; i < jobs.size(); i++) {
+      Job &job = jobs[i];
+      if (job.state != JOB_RUNNING || job.timed_out || timeout_sec <= 0) continue;
+      if (chrono::duration<double>(now - job.start).count() > timeout_sec) {
+        job.timed_out = true;
+        kill(-job.pid, SIGKILL);
+        kill(job.pid, SIGKILL);
+      }
+    }
+    this_thread::sleep_for(chrono::milliseconds(10));
+  }
+  double sweep_seconds = chrono::duration<double>(chrono::steady_clock::now() - sweep_start).count();
+
+  int nr_failed = 0;
+  double serial_seconds = 0;
+  printf("----------------------------------------------------------------------------------------\n");
+  printf("%-24s %-8s %5s %5s %14s %9s  %s\n", "job", "status", "exit", "halt", "cycles", "seconds", "save");
+  printf("----------------------------------------------------------------------------------------\n");
+  for (size_t i = 0; i < jobs.size(); i++) {
+    const Job &job = jobs[i];
+    const char *status = job_status(job);
+    bool pass = strcmp(status, "PASS") == 0;
+    int exit_code = WIFEXITED(job.wait_status) ? WEXITSTATUS(job.wait_status) : -WTERMSIG(job.wait_status);
+    printf("%-24s \033[%sm%-8s\033[0m %5d %5ld %14ld %9.2f  %s\n", job.name.c_str(), pass ? "32" : "31",
+           status, exit_code, job.halt, job.cycles, job.seconds, job.save.c_str());
+    nr_failed += !pass;
+    serial_seconds += job.seconds;
+  }
+  printf("----------------------------------------------------------------------------------------\n");
+  printf("%zu job(s), %d failed, %.2f s wall, %.2f s of emu time (%.2fx)\n", jobs.size(), nr_failed,
+         sweep_seconds, serial_seconds, sweep_seconds > 0 ? serial_seconds / sweep_seconds : 0.0);
+  return nr_failed ? 1 : 0;
+}
@@ -0,0 +1,110 @@
+// ram_bench.cpp
+// Host-side microbenchmark for the RAM DPI helpers.
+//
+// Replays the per-cycle DPI call pattern of top.v (one instruction fetch,
+// one scalar read, one write-helper call per posedge and the occasional
+// 512-bit vector access) against every RAM concurrency policy from
+// ram_policy.h and reports the host cost in ns per simulated cycle.
+//
+//   g++ -O3 -std=c++11 -I hw/csrc/ram hw/tools/ram_bench.cpp -lpthread
+//   ./ram_bench [cycles]
+#include <sys/mman.h>
+#include <chrono>
+#include <cinttypes>
+
+#include "config.h"
+#include "ram_policy.h"
+
+static const uint64_t nr_words = EMU_RAM_SIZE / sizeof(uint64_t);
+
+// same call sequence and checks as the helpers in ram.cpp
+template <class P>
+static inline uint64_t bench_read(uint64_t *ram, uint8_t en, uint64_t rIdx) {
+  if (en && rIdx >= nr_words) rIdx %= nr_words;
+  if (!en) return 0;
+  typename P::Guard guard;
+  return P::load(&ram[rIdx]);
+}
+
+template <class P>
+static inline void bench_write(uint64_t *ram, uint64_t wIdx, uint64_t wdata, uint64_t wmask, uint8_t wen) {
+  if (!wen) return;
+  assert(wIdx < nr_words);
+  typename P::Guard guard;
+  P::store(&ram[wIdx], wdata, wmask);
+}
+
+template <class P>
+static inline void bench_vread(uint64_t *ram, uint8_t en, uint64_t rIdx, uint32_t *rdata) {
+  if (!en) {
+    memset(rdata, 0, EMU_VLINE_BYTES);
+    return;
+  }
+  typename P::Guard guard;
+  P::load_line(&ram[rIdx % (nr_words - EMU_VLINE_WORDS)], rdata);
+}
+
+template <class P>
+static inline void bench_vwrite(uint64_t *ram, uint64_t wIdx, const uint32_t *wdata, const uint32_t *wmask, uint8_t wen) {
+  if (!wen) return;
+  uint64_t data[EMU_VLINE_WORDS], mask[EMU_VLINE_WORDS];
+  memcpy(data, wdata, EMU_VLINE_BYTES);
+  memcpy(mask, wmask, EMU_VLINE_BYTES);
+  typename P::Guard guard;
+  P::store_line(&ram[wIdx % (nr_words - EMU_VLINE_WORDS)], data, mask);
+}
+
+template <class P>
+static double run_bench(uint64_t *ram, uint64_t cycles, uint64_t *checksum) {
+  uint32_t vline[2 * EMU_VLINE_WORDS];
+  uint32_t vmask[2 * EMU_VLINE_WORDS];
+  memset(vline, 0x5a, sizeof(vline));
+  memset(vmask, 0xff, sizeof(vmask));
+
+  uint64_t pc = 0, lfsr = 0x2545f4914f6cdd1dUL, sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint64_t cycle = 0; cycle < cycles; cycle++) {
+    lfsr ^= lfsr << 13; lfsr ^= lfsr >> 7; lfsr ^= lfsr << 17;
+    // instruction fetch: sequential with a taken branch every 16 cycles
+    pc = (lfsr & 0xf) ? pc + 1 : (lfsr >> 40) & 0xffff;
+    sum += bench_read<P>(ram, 1, pc >> 1);
+    // scalar data port: ~25% loads, ~12% stores, data window at 8MB
+    uint64_t daddr = (1UL << 20) + ((lfsr >> 20) & 0xfffff);
+    sum += bench_read<P>(ram, (lfsr & 0x30) == 0, daddr);
+    bench_write<P>(ram, daddr, lfsr, 0xffUL << ((lfsr >> 8) & 0x38), (lfsr & 0x1c0) == 0);
+    // vector port: ~6% line loads, ~3% masked line stores
+    uint8_t vren = (lfsr & 0x3e00) == 0;
+    uint8_t vwen = (lfsr & 0x7c000) == 0 && !vren;
+    bench_vread<P>(ram, vren, daddr, vline);
+    bench_vwrite<P>(ram, daddr, vline, vmask, vwen);
+    sum += vline[0];
+  }
+  auto end = std::chrono::steady_clock::now();
+  *checksum += sum;
+  return std::chrono::duration<double, std::nano>(end - start).count() / cycles;
+}
+
+int main(int argc, char **argv) {
+  uint64_t cycles = (argc > 1) ? strtoull(argv[1], NULL, 0) : 20000000UL;
+  uint64_t *ram = (uint64_t *)mmap(NULL, EMU_RAM_SIZE, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+  if (ram == (uint64_t *)MAP_FAILED) {
+    printf("Cound not mmap 0x%lx bytes\n", EMU_RAM_SIZE);
+    return 1;
+  }
+
+  uint64_t checksum = 0;
+  // warm up page tables so the first policy is not charged for faults
+  run_bench<RamSingleThread>(ram, cycles / 10 + 1, &checksum);
+
+  double ns_mutex  = run_bench<RamGlobalMutex>(ram, cycles, &checksum);
+  double ns_single = run_bench<RamSingleThread>(ram, cycles, &checksum);
+  double ns_atomic = run_bench<RamAtomicWord>(ram, cycles, &checksum);
+
+  printf("RAM DPI helper cost over %" PRIu64 " cycles (checksum 0x%" PRIx64 ")\n", cycles, checksum);
+  printf("  %-28s %8.2f ns/cycle\n", "mutex  (before)", ns_mutex);
+  printf("  %-28s %8.2f ns/cycle  (%.2fx)\n", "single (default)", ns_single, ns_mutex / ns_single);
+  printf("  %-28s %8.2f ns/cycle  (%.2fx)\n", "atomic (--threads builds)", ns_atomic, ns_mutex / ns_atomic);
+
+  munmap(ram, EMU_RAM_SIZE);
+  return 0;
+}
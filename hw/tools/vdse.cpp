@@ -0,0 +1,331 @@
+// vdse.cpp
+// Design-space model of the vector unit, driven by a vector trace.
+//
+// Reads a trace written by `emu --vec-trace=FILE` (hw/csrc/vtrace/vtrace.h:
+// every vector instruction plus the number of scalar instructions between
+// them) and predicts whole-program cycles for vector units the RTL does
+// not implement: VLEN 256..2048 bits (SEW stays 64), fewer or more lanes,
+// multi-cycle ALU/multiply/divide latencies, and a wider or narrower, slower
+// or faster memory port.
+//
+// The model is in-order and cycle-approximate:
+//   - the front end issues one instruction per cycle; scalar instructions
+//     take one cycle each, a vector instruction blocks issue until it
+//     starts (its source registers are ready and its unit is free)
+//   - the ALU processes LANES elements per cycle and returns its result
+//     LAT cycles after the last elements; like v_execute.v, a reduction
+//     folds the elements of one pass in that pass, and only the partial
+//     results of several passes cost log2(passes) extra adder-tree steps
+//   - the memory port moves MEMW bytes per cycle, results after MEMLAT
+//   - the trace was recorded at VLEN 512: a full-register instruction stands
+//     for 512/VLEN instructions of the new unit (strip-mined loops run fewer
+//     or more iterations), partial ones (vmv.v.x, vlx/vsx) stay as they are.
+//     Scalar gaps of at most LOOP_GAP instructions are taken as the loop
+//     overhead around full-register work and scale the same way; longer
+//     gaps are scalar phases and do not.
+// With the RTL parameters (512 bits, 8 lanes, 64-byte port, all latencies
+// 1) every instruction takes one cycle, which is what emu measures without
+// a cache model; the tool checks that the RTL row comes out as the number
+// of instructions in the trace and warns when it does not.
+//
+//   g++ -O2 -std=c++11 -I./hw/csrc/vstat -I./hw/csrc/vtrace hw/tools/vdse.cpp -o vdse -lz
+//   ./vdse [-v VLENS] [-l LANES] [-m MEMWS] [-a LATS] [-x LATS] [-d LATS] [-L LATS]
+//          [-b BASE] [-g LOOP_GAP] [-n ROWS] TRACE
+#include <getopt.h>
+#include <zlib.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "vdecode.h"
+#include "vtrace.h"
+
+using namespace std;
+
+#define NO_REG      0xff
+#define RTL_ELEMS   VDEC_VLMAX
+
+enum { P_VLEN, P_LANES, P_MEMW, P_ALU_LAT, P_MUL_LAT, P_DIV_LAT, P_MEM_LAT, NR_PARAMS };
+static const char *param_names[NR_PARAMS] = { "vlen", "lanes", "memw", "alu_lat", "mul_lat", "div_lat", "mem_lat" };
+
+struct Config {
+  int p[NR_PARAMS];
+};
+
+struct Op {
+  VecOp    op;
+  bool     full;     // works on a whole 512-bit register
+  uint8_t  dst;
+  uint8_t  src[2];
+  uint64_t gap;      // scalar instructions before it
+};
+
+struct Result {
+  Config   cfg;
+  double   cycles;
+  double   alu_busy, port_busy;
+};
+
+static vector<Op> ops;
+static uint64_t tail_gap = 0;
+static uint64_t loop_gap = 16;
+
+static void load_trace(const char *path) {
+  gzFile f = gzopen(path, "rb");
+  if (f == NULL) {
+    printf("\033[31mERROR: Can not open vector trace %s\033[0m\n", path);
+    exit(2);
+  }
+  uint64_t magic = 0;
+  if (gzread(f, &magic, sizeof(magic)) != sizeof(magic) || magic != VTRACE_MAGIC) {
+    printf("\033[31mERROR: %s is not a vector trace\033[0m\n", path);
+    exit(2);
+  }
+  VecTraceRecord r;
+  uint8_t line[VTRACE_LINE_BYTES];
+  while (gzread(f, &r, sizeof(r)) == sizeof(r)) {
+    if (r.flags & VTRACE_END) {
+      tail_gap = r.gap;
+      break;
+    }
+    if (r.flags & (VTRACE_LOAD | VTRACE_STORE)) gzread(f, line, sizeof(line));
+    Op o;
+    o.op = vdecode(r.inst);
+    o.gap = r.gap;
+    o.dst = o.src[0] = o.src[1] = NO_REG;
+    uint8_t rd = (r.inst >> 7) & 0x1f, rs1 = (r.inst >> 15) & 0x1f, rs2 = (r.inst >> 20) & 0x1f;
+    uint32_t funct3 = (r.inst >> 12) & 0x7;
+    switch (o.op.kind) {
+      case VEC_ALU:
+        o.full = o.op.elems == RTL_ELEMS;
+        o.dst = rd;
+        if (o.op.alu != VALU_VMV_V_X) o.src[0] = rs2;
+        if (funct3 == 0 || o.op.alu == VALU_VREDSUM || o.op.alu == VALU_VREDMAX) o.src[1] = rs1;
+        break;
+      case VEC_LOAD:
+        o.full = !o.op.indexed;
+        o.dst = rd;
+        break;
+      case VEC_STORE:
+        o.full = !o.op.indexed;
+        o.src[0] = o.op.indexed ? rs2 : rd;
+        break;
+      default:
+        continue;
+    }
+    ops.push_back(o);
+  }
+  gzclose(f);
+}
+
+static int alu_latency(const Config &c, int alu) {
+  if (alu == VALU_VMUL) return c.p[P_MUL_LAT];
+  if (alu == VALU_VDIV) return c.p[P_DIV_LAT];
+  return c.p[P_ALU_LAT];
+}
+
+static Result simulate(const Config &c) {
+  const double elems = c.p[P_VLEN] / 64;
+  const int lanes = c.p[P_LANES];
+  double front = 0, alu_free = 0, port_free = 0, end = 0;
+  double ready[32] = { 0 };
+  double alu_busy = 0, port_busy = 0;
+  for (size_t i = 0; i < ops.size(); i++) {
+    const Op &o = ops[i];
+    // instructions of the new unit this one stands for
+    double n = o.full ? RTL_ELEMS / elems : max(1.0, ceil(o.op.elems / elems));
+    front += (o.full && o.gap <= loop_gap) ? o.gap * n : o.gap;
+    double t = front;
+    for (int k = 0; k < 2; k++) {
+      if (o.src[k] != NO_REG) t = max(t, ready[o.src[k]]);
+    }
+    // a merged group of instructions (n < 1) shares one latency
+    double lat_scale = min(n, 1.0);
+    double start, done;
+    if (o.op.kind == VEC_ALU) {
+      double per = o.full ? elems : min((double)o.op.elems, elems);
+      double occ = max(1.0, ceil(per / lanes));
+      double lat = alu_latency(c, o.op.alu) - 1;
+      if (o.op.alu == VALU_VREDSUM || o.op.alu == VALU_VREDMAX) lat += ceil(log2(occ));
+      start = max(t, alu_free);
+      alu_free = start + n * occ;
+      alu_busy += n * occ;
+      done = alu_free + lat * lat_scale;
+    } else {
+      double bytes = o.full ? elems * 8 : o.op.bytes / n;
+      double occ = max(1.0, ceil(bytes / c.p[P_MEMW]));
+      start = max(t, port_free);
+      port_free = start + n * occ;
+      port_busy += n * occ;
+      done = port_free + (c.p[P_MEM_LAT] - 1) * lat_scale;
+    }
+    if (o.dst != NO_REG && o.dst != 0) ready[o.dst] = done;
+    end = max(end, done);
+    front = start + n;
+  }
+  front += tail_gap;
+  Result r;
+  r.cfg = c;
+  r.cycles = max(end, front);
+  r.alu_busy = alu_busy;
+  r.port_busy = port_busy;
+  return r;
+}
+
+static bool parse_list(const char *arg, vector<int> *list) {
+  list->clear();
+  const char *p = arg;
+  while (*p) {
+    char *end;
+    long v = strtol(p, &end, 0);
+    if (end == p || v <= 0 || (*end != ',' && *end != '\0')) return false;
+    list->push_back(v);
+    p = *end ? end + 1 : end;
+  }
+  return !list->empty();
+}
+
+static string config_str(const Config &c) {
+  char buf[128];
+  snprintf(buf, sizeof(buf), "%5d %5d %5d %7d %7d %7d %7d", c.p[P_VLEN], c.p[P_LANES], c.p[P_MEMW],
+           c.p[P_ALU_LAT], c.p[P_MUL_LAT], c.p[P_DIV_LAT], c.p[P_MEM_LAT]);
+  return buf;
+}
+
+static void print_header() {
+  printf("  %5s %5s %5s %7s %7s %7s %7s %14s %8s %7s %7s\n", "vlen", "lanes", "memw", "alu_lat", "mul_lat",
+         "div_lat", "mem_lat", "cycles", "speedup", "alu%", "port%");
+}
+
+static void print_result(const Result &r, double base) {
+  printf("  %s %14.0f %7.3fx %6.1f%% %6.1f%%\n", config_str(r.cfg).c_str(), r.cycles, base / r.cycles,
+         100.0 * r.alu_busy / r.cycles, 100.0 * r.port_busy / r.cycles);
+}
+
+static bool valid(const Config &c) {
+  return c.p[P_VLEN] % 64 == 0 && c.p[P_LANES] <= c.p[P_VLEN] / 64;
+}
+
+static void print_usage(const char *prog) {
+  printf("Usage: %s [options] TRACE\n", prog);
+  printf("TRACE is written by emu --vec-trace=FILE; lists are comma separated\n");
+  printf("Options:\n");
+  printf("  -v VLENS      vector lengths in bits (default 256,512,1024,2048)\n");
+  printf("  -l LANES      64-bit lanes (default 1,2,4,8,16,32)\n");
+  printf("  -m MEMWS      memory port bytes per cycle (default 16,32,64,128,256)\n");
+  printf("  -a LATS       ALU latencies for the one-at-a-time table (default 1,2,4)\n");
+  printf("  -x LATS       multiply latencies (default 1,3,5)\n");
+  printf("  -d LATS       divide latencies (default 1,8,16)\n");
+  printf("  -L LATS       memory latencies (default 1,4,10)\n");
+  printf("  -b BASE       reference VLEN,LANES,MEMW,ALU,MUL,DIV,MEM (default: the RTL, 512,8,64,1,1,1,1)\n");
+  printf("  -g LOOP_GAP   longest scalar gap counted as loop overhead (default %lu)\n", loop_gap);
+  printf("  -n ROWS       rows of the full sweep to print (default 20)\n");
+}
+
+int main(int argc, char **argv) {
+  vector<int> values[NR_PARAMS] = {
+    { 256, 512, 1024, 2048 }, { 1, 2, 4, 8, 16, 32 }, { 16, 32, 64, 128, 256 },
+    { 1, 2, 4 }, { 1, 3, 5 }, { 1, 8, 16 }, { 1, 4, 10 },
+  };
+  Config rtl = { { 512, 8, 64, 1, 1, 1, 1 } };
+  Config base = rtl;
+  size_t nr_rows = 20;
+  static const char opt_param[] = "vlmaxdL";
+  int o;
+  while ((o = getopt(argc, argv, "v:l:m:a:x:d:L:b:g:n:h")) != -1) {
+    const char *pos = strchr(opt_param, o);
+    if (pos != NULL) {
+      if (!parse_list(optarg, &values[pos - opt_param])) {
+        printf("\033[31mERROR: bad list for -%c: %s\033[0m\n", o, optarg);
+        return 2;
+      }
+      continue;
+    }
+    switch (o) {
+      case 'b': {
+        vector<int> b;
+        if (!parse_list(optarg, &b) || b.size() != NR_PARAMS) {
+          printf("\033[31mERROR: -b expects VLEN,LANES,MEMW,ALU,MUL,DIV,MEM: %s\033[0m\n", optarg);
+          return 2;
+        }
+        for (int i = 0; i < NR_PARAMS; i++) base.p[i] = b[i];
+        break;
+      }
+      case 'g': loop_gap = strtoull(optarg, NULL, 0); break;
+      case 'n': nr_rows = strtoull(optarg, NULL, 0); break;
+      case 'h': print_usage(argv[0]); return 0;
+      default : print_usage(argv[0]); return 2;
+    }
+  }
+  if (optind != argc - 1) {
+    print_usage(argv[0]);
+    return 2;
+  }
+  if (!valid(base)) {
+    printf("\033[31mERROR: the reference needs VLEN a multiple of 64 and LANES <= VLEN / 64\033[0m\n");
+    return 2;
+  }
+  load_trace(argv[optind]);
+
+  uint64_t nr_scalar = tail_gap, nr_kind[4] = { 0 }, nr_full = 0;
+  for (size_t i = 0; i < ops.size(); i++) {
+    nr_scalar += ops[i].gap;
+    nr_kind[ops[i].op.kind]++;
+    nr_full += ops[i].full;
+  }
+  printf("Trace: %zu vector instructions (%lu ALU, %lu loads, %lu stores; %lu full-register), %lu scalar\n",
+         ops.size(), nr_kind[VEC_ALU], nr_kind[VEC_LOAD], nr_kind[VEC_STORE], nr_full, nr_scalar);
+
+  Result r_rtl = simulate(rtl);
+  Result r_base = simulate(base);
+  // one cycle per instruction, anything else is a bug in the model
+  if (r_rtl.cycles != nr_scalar + ops.size()) {
+    printf("\033[33mWARNING: the RTL configuration takes %.0f cycles, not one per instruction (%lu)\033[0m\n",
+           r_rtl.cycles, nr_scalar + ops.size());
+  }
+  printf("\033[34mRTL configuration\033[0m (compare with emu cycles without a cache model):\n");
+  print_header();
+  print_result(r_rtl, r_rtl.cycles);
+  printf("\033[34mReference configuration:\033[0m\n");
+  print_header();
+  print_result(r_base, r_base.cycles);
+
+  // one parameter at a time around the reference: which change buys the most
+  printf("\033[34mOne change at a time (speedup over the reference):\033[0m\n");
+  print_header();
+  vector<Result> single;
+  for (int p = 0; p < NR_PARAMS; p++) {
+    for (size_t i = 0; i < values[p].size(); i++) {
+      Config c = base;
+      c.p[p] = values[p][i];
+      // a shorter register keeps as many lanes as it has elements
+      if (p == P_VLEN) c.p[P_LANES] = min(c.p[P_LANES], c.p[P_VLEN] / 64);
+      if (c.p[p] == base.p[p] || !valid(c)) continue;
+      single.push_back(simulate(c));
+    }
+  }
+  sort(single.begin(), single.end(), [](const Result &a, const Result &b) { return a.cycles < b.cycles; });
+  for (size_t i = 0; i < single.size(); i++) print_result(single[i], r_base.cycles);
+
+  // full sweep of the structural parameters, latencies from the reference
+  vector<Result> sweep;
+  for (size_t v = 0; v < values[P_VLEN].size(); v++)
+    for (size_t l = 0; l < values[P_LANES].size(); l++)
+      for (size_t m = 0; m < values[P_MEMW].size(); m++) {
+        Config c = base;
+        c.p[P_VLEN] = values[P_VLEN][v];
+        c.p[P_LANES] = values[P_LANES][l];
+        c.p[P_MEMW] = values[P_MEMW][m];
+        if (valid(c)) sweep.push_back(simulate(c));
+      }
+  sort(sweep.begin(), sweep.end(), [](const Result &a, const Result &b) { return a.cycles < b.cycles; });
+  printf("\033[34mSweep of %s x %s x %s, best %zu of %zu:\033[0m\n", param_names[P_VLEN], param_names[P_LANES],
+         param_names[P_MEMW], min(nr_rows, sweep.size()), sweep.size());
+  print_header();
+  for (size_t i = 0; i < sweep.size() && i < nr_rows; i++) print_result(sweep[i], r_base.cycles);
+  return 0;
+}
@@ -0,0 +1,67 @@
+// hpm.v
+// Memory-mapped hardware performance counters.
+//
+// rvcpu has no CSR unit, so instead of csrr on mcycle/minstret/mhpmcounterN
+// software reads counter N with a 64-bit load from HPM_BASE + 8 * N
+// (sw klib hpm.h). Counters are read-only, stores to the window are
+// dropped, and all of them clear on reset.
+//
+//   0  cycle          every cycle
+//   1  instret        retired instructions (cycles without a memory stall)
+//   2  stall          memory stall cycles (top mem_stall)
+//   3  valu           vector ALU instructions (OP-V)
+//   4  vload          vector loads (vle64 / vlx)
+//   5  vstore         vector stores (vse64 / vsx)
+//   6  vload_bytes    bytes moved by vector loads
+//   7  vstore_bytes   bytes moved by vector stores
+//   8  vmem_elems     elements moved by vector loads and stores; divided
+//                     by 8 * (vload + vstore) this is the lane utilization
+
+`define HPM_BASE_PAGE   52'h00000_000a0000    // 0xa0000000, one 4KB page
+`define HPM_NR          9
+
+module hpm(
+  input           clk,
+  input           rst,
+
+  // events, sampled on the rising edge
+  input           ev_retire,
+  input           ev_stall,
+  input           ev_valu,
+  input           ev_vload,
+  input           ev_vstore,
+  input  [3:0]    ev_velems,
+  input  [6:0]    ev_vbytes,
+
+  // scalar load/store port of the core, decoded against the window
+  input  [63:0]   raddr,
+  output          rsel,
+  output [63:0]   rdata,
+  input  [63:0]   waddr,
+  output          wsel
+);
+  reg [63:0] cnt [0 : `HPM_NR - 1];
+
+  assign rsel  = raddr[63:12] == `HPM_BASE_PAGE;
+  assign wsel  = waddr[63:12] == `HPM_BASE_PAGE;
+  assign rdata = (raddr[11:3] < `HPM_NR) ? cnt[raddr[6:3]] : 64'b0;
+
+  integer i;
+  always @(posedge clk) begin
+    if (rst) begin
+      for (i = 0; i < `HPM_NR; i = i + 1)
+        cnt[i] <= 64'b0;
+    end
+    else begin
+      cnt[0] <= cnt[0] + 64'd1;
+      cnt[1] <= cnt[1] + {63'b0, ev_retire};
+      cnt[2] <= cnt[2] + {63'b0, ev_stall};
+      cnt[3] <= cnt[3] + {63'b0, ev_valu};
+      cnt[4] <= cnt[4] + {63'b0, ev_vload};
+      cnt[5] <= cnt[5] + {63'b0, ev_vstore};
+      cnt[6] <= cnt[6] + (ev_vload  ? {57'b0, ev_vbytes} : 64'b0);
+      cnt[7] <= cnt[7] + (ev_vstore ? {57'b0, ev_vbytes} : 64'b0);
+      cnt[8] <= cnt[8] + {60'b0, ev_velems};
+    end
+  end
+endmodule
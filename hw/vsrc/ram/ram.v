@@ -34,6 +34,21 @@ import "DPI-C" function longint ram_inst_helper
   input  longint    rIdx
 );
 
+import "DPI-C" function void ram_vread512_helper
+(
+  input  bit          en,
+  input  longint      rIdx,
+  output bit [511:0]  rdata
+);
+
+import "DPI-C" function void ram_vwrite512_helper
+(
+  input  longint      wIdx,
+  input  bit [511:0]  wdata,
+  input  bit [511:0]  wmask,
+  input  bit          wen
+);
+
 
 module RAMHelper(
   input         clk,
@@ -9,14 +9,14 @@ module RAMVectorHelper(
   input  [511:0]  wmask,
   input           wen
 );
-  genvar i ;
-  for (i=0; i<8; i=i+1) begin
-    assign rdata[64*(i+1)-1:64*i] = ram_read_helper(ren, rIdx+i);
+  // one DPI call moves the whole 512-bit line (8 x 64-bit words)
+  reg [511:0] rdata_r;
+  always @(*) begin
+    ram_vread512_helper(ren, rIdx, rdata_r);
   end
+  assign rdata = rdata_r;
 
-  for (i=0; i<8; i=i+1) begin
-    always @(posedge clk) begin
-      ram_write_helper(wIdx+i, wdata[64*(i+1)-1:64*i], wmask[64*(i+1)-1:64*i], wen );
-    end  
+  always @(posedge clk) begin
+    ram_vwrite512_helper(wIdx, wdata, wmask, wen);
   end
 endmodule 
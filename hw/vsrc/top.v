@@ -8,9 +8,24 @@
 
 `define PC_START   64'h00000000_80000000 
 
+// Native RAM (build.sh -N defines EMU_NATIVE_RAM): the memory is the
+// ram_mem array below instead of the DPI helpers in ram.v, so Verilator
+// turns every fetch, load and store into a plain array access. The host
+// reaches it through the public handle only (csrc/ram/ram_native.h), to
+// load the images before the run and to save the data after it.
+// EMU_RAM_WORDS must match EMU_RAM_SIZE in csrc/ram/config.h.
+`define EMU_RAM_WORDS   (1 << 23)   // 64 MB
+
 module top(
     input clock,
-    input reset
+    input reset,
+    // miss latency from the C++ cache model: hold the pc, issue nops
+    input mem_stall,
+    // current pc/instruction, observed by the C++ harness every cycle
+    output [63:0] debug_pc,
+    output [31:0] debug_inst,
+    // rs1 value handed to the vector unit, for the vector trace (vtrace.h)
+    output [63:0] debug_vec_rs1
 );
 
 wire            inst_ena ;
@@ -23,7 +38,8 @@ wire [63 : 0]   rdata_inst;
 
 wire            ram_r_ena ;
 wire [63 : 0]   ram_r_addr ;
-reg  [63 : 0]   ram_r_data ;
+wire [63 : 0]   ram_r_data ;
+wire [63 : 0]   ram_rdata_mem ;
 
 wire            ram_w_ena ;
 wire [63 : 0]   ram_w_addr ;
@@ -34,6 +50,22 @@ wire [63 : 0]   regs[0 : 31];
 
 wire            pc_stall;
 
+`ifdef EMU_NATIVE_RAM
+  reg  [63 : 0] ram_mem [0 : `EMU_RAM_WORDS - 1] /*verilator public*/;
+  // enabled stores, for the hang watchdog (ram.cpp counts them otherwise)
+  reg  [63 : 0] ram_writes /*verilator public*/;
+  // word index of addr; PC_START is a multiple of the RAM size, so this is
+  // (addr - PC_START) >> 3 wrapped around the end of RAM like the DPI reads
+  function [22 : 0] ram_idx(input [63 : 0] addr);
+    ram_idx = addr[25 : 3];
+  endfunction
+`endif
+
+assign pc_stall   = mem_stall;
+
+assign debug_pc   = inst_addr;
+assign debug_inst = inst;
+
 rvcpu RV64I(
     clock ,
     reset ,
@@ -52,24 +84,44 @@ rvcpu RV64I(
 );
 
 wire [63:0] rom_rdata;
-assign inst = inst_addr[2] ? rom_rdata[63 : 32] : rom_rdata[31 : 0];
+// while stalled the held instruction must not execute (and access memory)
+// again every cycle, so the core and the vector unit see a nop instead
+assign inst = pc_stall ? 32'h00000013 :
+              inst_addr[2] ? rom_rdata[63 : 32] : rom_rdata[31 : 0];
+`ifdef EMU_NATIVE_RAM
+assign rom_rdata = ram_mem[ram_idx(inst_addr)];
+`else
 ROMHelper ROM_INST(
   .clk              (clock),
-  .ren              (1),
+  .ren              (!pc_stall),
   .rIdx             ((inst_addr - `PC_START) >> 3),
   .rdata            (rom_rdata)
 );
+`endif
 
+// loads from the performance counter window are served by hpm instead of
+// RAM; stores to it are dropped
+wire            hpm_rsel ;
+wire            hpm_wsel ;
+wire [63 : 0]   hpm_rdata ;
+assign ram_r_data = hpm_rsel ? hpm_rdata : ram_rdata_mem;
+
+`ifdef EMU_NATIVE_RAM
+wire [63 : 0]   ram_w_idx = (ram_w_addr - `PC_START) >> 3 ;
+wire            ram_w_mem = ram_w_ena && !hpm_wsel ;
+assign ram_rdata_mem = ram_r_ena ? ram_mem[ram_idx(ram_r_addr)] : 64'd0;
+`else
 RAMHelper RAM(
   .clk              ( clock ),
-  .ren              ( ram_r_ena  ),
+  .ren              ( ram_r_ena && !hpm_rsel ),
   .rIdx             ( (ram_r_addr - `PC_START) >> 3 ),
-  .rdata            ( ram_r_data ),
+  .rdata            ( ram_rdata_mem ),
   .wIdx             ( (ram_w_addr - `PC_START) >> 3 ),
   .wdata            ( ram_w_data ),
   .wmask            ( ram_w_mask ),
-  .wen              ( ram_w_ena  )
+  .wen              ( ram_w_ena && !hpm_wsel )
 );
+`endif
 
 `ifdef VECTOR_ENALBE
   wire          vec_rs1_r_ena ;
@@ -85,7 +137,14 @@ RAMHelper RAM(
   wire [511:0]  vram_w_data ;
   wire [511:0]  vram_w_mask ;
 
+  wire          perf_valu ;
+  wire          perf_vload ;
+  wire          perf_vstore ;
+  wire [3:0]    perf_velems ;
+  wire [6:0]    perf_vbytes ;
+
   assign vec_rs1_data = vec_rs1_r_ena ? regs[vec_rs1_r_addr]  : 0 ;
+  assign debug_vec_rs1 = vec_rs1_data;
   v_rvcpu RV_VECTOR(
     .clk              ( clock ),
     .rst              ( reset ),
@@ -103,18 +162,103 @@ RAMHelper RAM(
     .vram_w_ena       ( vram_w_ena ),
     .vram_w_addr      ( vram_w_addr ),
     .vram_w_data      ( vram_w_data ),
-    .vram_w_mask      ( vram_w_mask )
+    .vram_w_mask      ( vram_w_mask ),
+
+    .perf_valu        ( perf_valu ),
+    .perf_vload       ( perf_vload ),
+    .perf_vstore      ( perf_vstore ),
+    .perf_velems      ( perf_velems ),
+    .perf_vbytes      ( perf_vbytes )
   );
+  // the vector unit decodes the same (nop while stalled) inst; its memory
+  // port is held as well so a stall can never let a vector access through
+  wire          vec_stall = pc_stall;
+`ifdef EMU_NATIVE_RAM
+  // the 512-bit line is 8 consecutive words, word 0 in the low bits
+  wire [63:0]   vram_w_idx = (vram_w_addr - `PC_START) >> 3 ;
+  wire          vram_w_mem = vram_w_ena && !vec_stall ;
+  genvar vi;
+  generate
+    for ( vi = 0; vi < 8; vi = vi + 1 ) begin : VRAM_WORD
+      wire [22:0] r_idx = ram_idx(vram_r_addr) + vi;
+      assign vram_r_data[vi*64 +: 64] = ( vram_r_ena && !vec_stall ) ? ram_mem[r_idx] : 64'd0;
+    end
+  endgenerate
+`else
   RAMVectorHelper RAM_VECOTR(
     .clk              ( clock ),
-    .ren              ( vram_r_ena  ),
+    .ren              ( vram_r_ena && !vec_stall ),
     .rIdx             ( (vram_r_addr - `PC_START) >> 3 ),
     .rdata            ( vram_r_data ),
     .wIdx             ( (vram_w_addr - `PC_START) >> 3 ),
     .wdata            ( vram_w_data ),
     .wmask            ( vram_w_mask ),
-    .wen              ( vram_w_ena  )
+    .wen              ( vram_w_ena && !vec_stall )
   );
+`endif
+`else
+  wire          perf_valu   = 1'b0;
+  wire          perf_vload  = 1'b0;
+  wire          perf_vstore = 1'b0;
+  wire [3:0]    perf_velems = 4'd0;
+  wire [6:0]    perf_vbytes = 7'd0;
+  assign debug_vec_rs1 = 64'd0;
 `endif 
 
+`ifdef EMU_NATIVE_RAM
+// all stores in one block, scalar first, then the masked vector line;
+// out-of-bound stores stop the simulation like the asserts in ram.cpp
+integer wi;
+always @(posedge clock) begin
+  if ( ram_w_mem ) begin
+    if ( ram_w_idx >= `EMU_RAM_WORDS ) begin
+      $display("ERROR: ram wIdx = 0x%h out of bound!", ram_w_idx);
+      $stop;
+    end
+    ram_mem[ram_w_idx[22:0]] <= (ram_mem[ram_w_idx[22:0]] & ~ram_w_mask) | (ram_w_data & ram_w_mask);
+  end
+`ifdef VECTOR_ENALBE
+  if ( vram_w_mem ) begin
+    if ( vram_w_idx > `EMU_RAM_WORDS - 8 ) begin
+      $display("ERROR: vram wIdx = 0x%h out of bound!", vram_w_idx);
+      $stop;
+    end
+    for ( wi = 0; wi < 8; wi = wi + 1 )
+      ram_mem[vram_w_idx[22:0] + wi[22:0]] <= (ram_mem[vram_w_idx[22:0] + wi[22:0]] & ~vram_w_mask[wi*64 +: 64])
+                                             | (vram_w_data[wi*64 +: 64] & vram_w_mask[wi*64 +: 64]);
+  end
+`endif
+end
+
+always @(posedge clock) begin
+  if ( reset )
+    ram_writes <= 64'd0;
+  else if ( ram_w_mem
+`ifdef VECTOR_ENALBE
+            || vram_w_mem
+`endif
+          )
+    ram_writes <= ram_writes + 64'd1;
+end
+`endif
+
+// performance counters; a stall cycle retires nothing and the vector unit
+// only sees a nop then, so its events need no extra gating
+hpm HPM(
+  .clk              ( clock ),
+  .rst              ( reset ),
+  .ev_retire        ( !pc_stall ),
+  .ev_stall         ( pc_stall ),
+  .ev_valu          ( perf_valu ),
+  .ev_vload         ( perf_vload ),
+  .ev_vstore        ( perf_vstore ),
+  .ev_velems        ( perf_velems ),
+  .ev_vbytes        ( perf_vbytes ),
+  .raddr            ( ram_r_addr ),
+  .rsel             ( hpm_rsel ),
+  .rdata            ( hpm_rdata ),
+  .waddr            ( ram_w_addr ),
+  .wsel             ( hpm_wsel )
+);
+
 endmodule
@@ -17,8 +17,17 @@ module v_rvcpu(
     output                      vram_w_ena,
     output  [`VRAM_ADDR_BUS]    vram_w_addr,
     output  [`VRAM_DATA_BUS]    vram_w_data,
-    output  [`VRAM_DATA_BUS]    vram_w_mask
+    output  [`VRAM_DATA_BUS]    vram_w_mask,
+
+    // performance events of the current instruction (hpm.v)
+    output                      perf_valu,
+    output                      perf_vload,
+    output                      perf_vstore,
+    output  [3:0]               perf_velems,
+    output  [6:0]               perf_vbytes
 );
+    // verilated as a separate block in multithreaded builds (--hierarchical)
+    /*verilator hier_block*/
 
     //========================================================
     // 1) Decode 输出（控制信号 + 操作数 + 内存/写回控制）
@@ -150,6 +159,18 @@ module v_rvcpu(
     assign vram_w_data = vram_din_int;
     assign vram_w_mask = vram_mask_int;
 
+    // 性能事件：OP-V 指令总是写回 ALU 结果；VLE64/VSE64 搬运 8 个 64 位元素，
+    // VLX/VSX 搬运 len+1 个 width 位元素（width 1xx 时 v_mem 不搬运任何数据）
+    wire       vmem_is_x  = vmem_is_vlx | vmem_is_vsx;
+    wire [3:0] vmem_x_cnt = vmem_width[2] ? 4'd0 : {1'b0, vmem_len} + 4'd1;
+    assign perf_valu   = vid_wb_en & ~vid_wb_sel;
+    assign perf_vload  = vmem_ren;
+    assign perf_vstore = vmem_wen;
+    assign perf_velems = (~vmem_ren & ~vmem_wen) ? 4'd0 :
+                         vmem_is_x ? vmem_x_cnt : 4'd8;
+    assign perf_vbytes = (~vmem_ren & ~vmem_wen) ? 7'd0 :
+                         vmem_is_x ? ({3'b0, vmem_x_cnt} << vmem_width[1:0]) : 7'd64;
+
     //========================================================
     // 5) Write-back：选择写回来源（ALU 或 Mem）
     //========================================================
@@ -0,0 +1,179 @@
+// vtb_main.cpp
+// Trace replay harness for the vector unit.
+//
+// Replays a vector instruction trace recorded by `emu --vec-trace=FILE`
+// (hw/csrc/vtrace/vtrace.h) on v_rvcpu alone (vtb_top.v): one instruction
+// per cycle, the recorded rs1 value on the scalar register port, loads
+// served from the recorded lines, and every store checked against the line
+// the full system wrote. Without the scalar core, the instruction fetch and
+// the RAM the run measures how fast the vector unit itself simulates, and
+// changes to it can be checked against a stream from the real program.
+//
+// With -r the stream is replayed several times to get a longer timing run;
+// the vector registers then carry over between passes, so stores are only
+// checked in the first one.
+//
+//   make sim CFILE=vec_op_nn_test EMU_ARGS=--vec-trace=$PWD/vec.trace.gz
+//   make vtb VTB_TRACE=vec.trace.gz
+//   ./hw/build/vtb [-n N] [-r R] [-q] TRACE
+#include <getopt.h>
+#include <zlib.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <verilated.h>
+#include "Vvtb_top.h"
+#include "vtrace.h"
+
+#define VTB_LINE_WORDS  (VTRACE_LINE_BYTES / 8)
+#define VTB_MAX_ERRORS  10
+
+struct Entry {
+  VecTraceRecord rec;
+  size_t line;       // index into lines, loads and stores only
+};
+
+static std::vector<Entry> entries;
+static std::vector<uint64_t> lines;
+static const Entry *cur = NULL;
+static bool check = true;
+static uint64_t nr_errors = 0;
+
+static void load_trace(const char *path) {
+  gzFile f = gzopen(path, "rb");
+  if (f == NULL) {
+    printf("\033[31mERROR: Can not open vector trace %s\033[0m\n", path);
+    exit(2);
+  }
+  uint64_t magic = 0;
+  if (gzread(f, &magic, sizeof(magic)) != sizeof(magic) || magic != VTRACE_MAGIC) {
+    printf("\033[31mERROR: %s is not a vector trace\033[0m\n", path);
+    exit(2);
+  }
+  Entry e;
+  while (gzread(f, &e.rec, sizeof(e.rec)) == sizeof(e.rec) && !(e.rec.flags & VTRACE_END)) {
+    e.line = lines.size();
+    if (e.rec.flags & (VTRACE_LOAD | VTRACE_STORE)) {
+      lines.resize(lines.size() + VTB_LINE_WORDS);
+      if (gzread(f, &lines[e.line], VTRACE_LINE_BYTES) != VTRACE_LINE_BYTES) {
+        printf("\033[31mERROR: %s is truncated\033[0m\n", path);
+        exit(2);
+      }
+    }
+    entries.push_back(e);
+  }
+  gzclose(f);
+}
+
+static void error(const char *what, uint64_t expected, uint64_t got) {
+  if (nr_errors++ < VTB_MAX_ERRORS) {
+    printf("\033[31mMISMATCH\033[0m at #%lu (inst 0x%08x): %s, expected 0x%lx, got 0x%lx\n",
+           (uint64_t)(cur - entries.data()), cur->rec.inst, what, expected, got);
+  }
+}
+
+extern "C" void vtb_vread512_helper(uint8_t en, uint64_t rIdx, uint32_t *rdata) {
+  if (!en || cur == NULL || !(cur->rec.flags & VTRACE_LOAD)) {
+    memset(rdata, 0, VTRACE_LINE_BYTES);
+    return;
+  }
+  memcpy(rdata, &lines[cur->line], VTRACE_LINE_BYTES);
+}
+
+extern "C" void vtb_vwrite512_helper(uint64_t wIdx, const uint32_t *wdata, const uint32_t *wmask, uint8_t wen) {
+  if (!wen || !check) return;
+  if (!(cur->rec.flags & VTRACE_STORE)) {
+    error("store from a non-store", 0, wIdx);
+    return;
+  }
+  if (wIdx != cur->rec.idx) error("store word index", cur->rec.idx, wIdx);
+  uint64_t data[VTB_LINE_WORDS], mask[VTB_LINE_WORDS];
+  memcpy(data, wdata, sizeof(data));
+  memcpy(mask, wmask, sizeof(mask));
+  for (int i = 0; i < VTB_LINE_WORDS; i++) {
+    if ((data[i] ^ lines[cur->line + i]) & mask[i]) {
+      error("stored word", lines[cur->line + i] & mask[i], data[i] & mask[i]);
+      break;
+    }
+  }
+}
+
+static void print_usage(const char *prog) {
+  printf("Usage: %s [-n N] [-r R] [-q] TRACE\n", prog);
+  printf("TRACE is written by emu --vec-trace=FILE\n");
+  printf("Options:\n");
+  printf("  -n N   replay only the first N instructions\n");
+  printf("  -r R   replay the stream R times (stores are checked in the first pass only)\n");
+  printf("  -q     do not check stores\n");
+}
+
+int main(int argc, char **argv) {
+  uint64_t max_insts = 0;
+  int repeat = 1;
+  int o;
+  while ((o = getopt(argc, argv, "n:r:qh")) != -1) {
+    switch (o) {
+      case 'n': max_insts = strtoull(optarg, NULL, 0); break;
+      case 'r': repeat = atoi(optarg); break;
+      case 'q': check = false; break;
+      case 'h': print_usage(argv[0]); return 0;
+      default : print_usage(argv[0]); return 2;
+    }
+  }
+  if (optind != argc - 1 || repeat < 1) {
+    print_usage(argv[0]);
+    return 2;
+  }
+  load_trace(argv[optind]);
+  if (max_insts && max_insts < entries.size()) entries.resize(max_insts);
+  printf("Replaying %zu vector instruction(s) x %d\n", entries.size(), repeat);
+
+  Vvtb_top *top = new Vvtb_top;
+  top->inst = 0;
+  top->rs1_data = 0;
+  top->reset = 1;
+  top->clock = 0;
+  top->eval();
+  top->clock = 1;
+  top->eval();
+  top->reset = 0;
+
+  uint64_t nr_valu = 0, nr_vload = 0, nr_vstore = 0, nr_elems = 0, nr_bytes = 0, nr_cycles = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < repeat; pass++) {
+    for (size_t i = 0; i < entries.size(); i++) {
+      cur = &entries[i];
+      top->inst = cur->rec.inst;
+      top->rs1_data = cur->rec.rs1;
+      top->clock = 0;
+      top->eval();
+      nr_valu += top->perf_valu;
+      nr_vload += top->perf_vload;
+      nr_vstore += top->perf_vstore;
+      nr_elems += top->perf_velems;
+      nr_bytes += top->perf_vbytes;
+      top->clock = 1;
+      top->eval();
+      nr_cycles++;
+    }
+    check = false;
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  top->final();
+  delete top;
+
+  printf("----------------------------------------------------------\n");
+  printf("valu %lu, vload %lu, vstore %lu, %lu elements, %lu bytes moved\n",
+         nr_valu, nr_vload, nr_vstore, nr_elems, nr_bytes);
+  printf("\033[34mReplay speed: \033[35m%.0f\033[34m instructions/s (%lu in %.3f s)\033[0m\n",
+         seconds > 0 ? nr_cycles / seconds : 0.0, nr_cycles, seconds);
+  if (nr_errors) {
+    printf("\033[31m%lu store mismatch(es)\033[0m\n", nr_errors);
+    return 1;
+  }
+  printf("\033[32mAll stores match the trace\033[0m\n");
+  return 0;
+}
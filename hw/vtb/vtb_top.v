@@ -0,0 +1,83 @@
+// vtb_top.v
+// Vector unit testbench top: v_rvcpu alone, no scalar core and no fetch.
+// vtb_main.cpp drives one traced instruction and its rs1 value per cycle;
+// the 512-bit RAM port goes to the DPI helpers below, which serve loads
+// from the trace and check stores against it.
+
+import "DPI-C" function void vtb_vread512_helper
+(
+  input  bit          en,
+  input  longint      rIdx,
+  output bit [511:0]  rdata
+);
+
+import "DPI-C" function void vtb_vwrite512_helper
+(
+  input  longint      wIdx,
+  input  bit [511:0]  wdata,
+  input  bit [511:0]  wmask,
+  input  bit          wen
+);
+
+`define PC_START   64'h00000000_80000000
+
+module vtb_top(
+  input           clock,
+  input           reset,
+  input  [31:0]   inst,
+  input  [63:0]   rs1_data,
+  output          perf_valu,
+  output          perf_vload,
+  output          perf_vstore,
+  output [3:0]    perf_velems,
+  output [6:0]    perf_vbytes
+);
+
+  wire          vec_rs1_r_ena ;
+  wire [4:0]    vec_rs1_r_addr ;
+
+  wire          vram_r_ena ;
+  wire [63:0]   vram_r_addr ;
+  reg  [511:0]  vram_r_data ;
+
+  wire          vram_w_ena ;
+  wire [63:0]   vram_w_addr ;
+  wire [511:0]  vram_w_data ;
+  wire [511:0]  vram_w_mask ;
+
+  v_rvcpu RV_VECTOR(
+    .clk              ( clock ),
+    .rst              ( reset ),
+
+    .inst             ( inst ),
+
+    // the traced value is what top.v handed over for this instruction
+    .vec_rs1_data     ( vec_rs1_r_ena ? rs1_data : 64'd0 ),
+    .vec_rs1_r_ena    ( vec_rs1_r_ena ),
+    .vec_rs1_r_addr   ( vec_rs1_r_addr ),
+
+    .vram_r_ena       ( vram_r_ena ),
+    .vram_r_addr      ( vram_r_addr ),
+    .vram_r_data      ( vram_r_data ),
+
+    .vram_w_ena       ( vram_w_ena ),
+    .vram_w_addr      ( vram_w_addr ),
+    .vram_w_data      ( vram_w_data ),
+    .vram_w_mask      ( vram_w_mask ),
+
+    .perf_valu        ( perf_valu ),
+    .perf_vload       ( perf_vload ),
+    .perf_vstore      ( perf_vstore ),
+    .perf_velems      ( perf_velems ),
+    .perf_vbytes      ( perf_vbytes )
+  );
+
+  always @(*) begin
+    vtb_vread512_helper(vram_r_ena, (vram_r_addr - `PC_START) >> 3, vram_r_data);
+  end
+
+  always @(posedge clock) begin
+    vtb_vwrite512_helper((vram_w_addr - `PC_START) >> 3, vram_w_data, vram_w_mask, vram_w_ena);
+  end
+
+endmodule
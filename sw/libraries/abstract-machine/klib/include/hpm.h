@@ -0,0 +1,56 @@
+#ifndef KLIB_HPM_H__
+#define KLIB_HPM_H__
+
+#include <am.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Hardware performance counters (hw/vsrc/perf/hpm.v). The core has no CSR
+// unit, so the counters are memory mapped: counter N is the 64-bit word at
+// HPM_BASE + 8 * N. Snapshot before and after a region, then diff:
+//
+//   hpm_t start, end, delta;
+//   hpm_snapshot(&start);
+//   conv2d(...);
+//   hpm_snapshot(&end);
+//   hpm_diff(&delta, &end, &start);
+//   hpm_print("conv2d", &delta);
+//
+// or, for the common case, hpm_report("conv2d", &start) in place of the
+// last three lines.
+
+#define HPM_BASE 0xa0000000UL
+
+enum {
+  HPM_CYCLE,          // cycles
+  HPM_INSTRET,        // retired instructions
+  HPM_STALL,          // memory stall cycles
+  HPM_VALU,           // vector ALU instructions
+  HPM_VLOAD,          // vector loads (vle64 / vlx)
+  HPM_VSTORE,         // vector stores (vse64 / vsx)
+  HPM_VLOAD_BYTES,    // bytes moved by vector loads
+  HPM_VSTORE_BYTES,   // bytes moved by vector stores
+  HPM_VMEM_ELEMS,     // elements moved by vector loads and stores
+  HPM_NR
+};
+
+typedef struct {
+  uint64_t cnt[HPM_NR];
+} hpm_t;
+
+static inline uint64_t hpm_read(int event) {
+  return *(volatile uint64_t *)(HPM_BASE + 8 * event);
+}
+
+void hpm_snapshot(hpm_t *s);
+void hpm_diff(hpm_t *delta, const hpm_t *end, const hpm_t *start);
+void hpm_print(const char *name, const hpm_t *delta);
+void hpm_report(const char *name, const hpm_t *start);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
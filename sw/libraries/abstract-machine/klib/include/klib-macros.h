@@ -36,4 +36,13 @@
 
 #define panic(s) panic_on(1, s)
 
+// Region-of-interest markers: a nop in the custom-2 opcode space carrying
+// a constant 12-bit id, next to putch (0x0005007f) and halt (0x0000006b) in
+// trm.c. emu reports cycles per region and `--roi=ID` limits its profile,
+// vector stats, memory trace and waveform to the region.
+#define ROI_BEGIN(id) \
+  asm volatile(".word %0" : : "i"((((unsigned)(id) & 0xfffu) << 20) | 0x005b) : "memory")
+#define ROI_END(id) \
+  asm volatile(".word %0" : : "i"((((unsigned)(id) & 0xfffu) << 20) | 0x105b) : "memory")
+
 #endif
@@ -0,0 +1,44 @@
+#include <am.h>
+#include <klib.h>
+#include <hpm.h>
+
+// Each read is one load, so the counters are sampled on consecutive cycles;
+// the snapshot itself adds a handful of cycles and instructions to a region.
+void hpm_snapshot(hpm_t *s) {
+  for (int i = 0; i < HPM_NR; i++) {
+    s->cnt[i] = hpm_read(i);
+  }
+}
+
+void hpm_diff(hpm_t *delta, const hpm_t *end, const hpm_t *start) {
+  for (int i = 0; i < HPM_NR; i++) {
+    delta->cnt[i] = end->cnt[i] - start->cnt[i];
+  }
+}
+
+// x / y in fixed point with three decimals
+static void print_ratio(const char *label, uint64_t x, uint64_t y) {
+  uint64_t r = y ? x * 1000 / y : 0;
+  printf(" %s %d.%03d", label, (int)(r / 1000), (int)(r % 1000));
+}
+
+void hpm_print(const char *name, const hpm_t *d) {
+  const uint64_t *c = d->cnt;
+  uint64_t vmem = c[HPM_VLOAD] + c[HPM_VSTORE];
+  printf("[hpm] %s: cycles %lu instret %lu", name, c[HPM_CYCLE], c[HPM_INSTRET]);
+  print_ratio("IPC", c[HPM_INSTRET], c[HPM_CYCLE]);
+  printf(" stall %lu\n", c[HPM_STALL]);
+  printf("[hpm] %s: valu %lu vload %lu (%lu B) vstore %lu (%lu B)", name, c[HPM_VALU],
+         c[HPM_VLOAD], c[HPM_VLOAD_BYTES], c[HPM_VSTORE], c[HPM_VSTORE_BYTES]);
+  // a vle64/vse64 moves all 8 lanes, a vlx/vsx only len + 1 of them
+  print_ratio("lane-util", c[HPM_VMEM_ELEMS], vmem * 8);
+  print_ratio("vec/inst", c[HPM_VALU] + vmem, c[HPM_INSTRET]);
+  printf("\n");
+}
+
+void hpm_report(const char *name, const hpm_t *start) {
+  hpm_t end, delta;
+  hpm_snapshot(&end);
+  hpm_diff(&delta, &end, start);
+  hpm_print(name, &delta);
+}
@@ -1,5 +1,7 @@
 #include <am.h>
 #include <klib.h>
+#include <hpm.h>
+#include <klib-macros.h>
 #include "vec_op.h"
 
 // ==========================================
@@ -48,6 +50,8 @@ static int32_t softmax_out[10] __attribute__((aligned(8)));
 // ==========================================
 
 int main() {
+    // layer N is region N for emu (ROI_BEGIN) and reports its own counters
+    hpm_t layer;
     printf("\n=== RISC-V Neural Network Inference (VECTOR VERSION) ===\n");
     // ------------------------------------------
     // Layer 1: Conv2D + Scale + Clip
@@ -58,6 +62,8 @@ int main() {
     int H_out = 12, W_out = 12; // (14-3+1)
     
     printf("1. Executing Conv2D (Vector)...\n");
+    hpm_snapshot(&layer);
+    ROI_BEGIN(1);
     
     // 1.1 Im2Col (Input -> Col Buffer) - VECTOR VERSION
     im2col_input_int8_vec((int8_t*)ADDR_INPUT, col_buf, Cin, Hin, Win, K);
@@ -80,12 +86,16 @@ int main() {
         M, N_patches, K_dim, 
         conv_scale
     );
+    ROI_END(1);
+    hpm_report("conv2d", &layer);
 
     // ------------------------------------------
     // Layer 2: MaxPool 2x2
     // ------------------------------------------
     // Input: [12, 12, 4] (NHWC) -> Output: [6, 6, 4]
     printf("2. Executing MaxPool (Vector)...\n");
+    hpm_snapshot(&layer);
+    ROI_BEGIN(2);
     maxpool_int16_vec(conv_out_nhwc, pool_out, Cout, H_out, W_out);
 
     // ------------------------------------------
@@ -94,6 +104,8 @@ int main() {
     // pool_out: [6, 6, 4] (NHWC)
     // conv_out_nchw: [4, 6, 6] (NCHW) - buffer is large enough (4*12*12)
     transpose_NHWC_to_NCHW_vec(pool_out, conv_out_nhwc, Cout, 6, 6);
+    ROI_END(2);
+    hpm_report("maxpool", &layer);
 
     // ------------------------------------------
     // Layer 4: Fully Connected 1
@@ -102,6 +114,8 @@ int main() {
     // Weight shape in memory: [144, 60] (Transposed by gen_data)
     // Calculation: Input_Row(1, 144) x Weight(144, 60) = Output(1, 60)
     printf("3. Executing FC1 (Vector)...\n");
+    hpm_snapshot(&layer);
+    ROI_BEGIN(3);
 
     int32_t *fc1_scale_ptr = (int32_t*)ADDR_SFC1;
     int fc1_in_features = 144;
@@ -119,6 +133,8 @@ int main() {
 
     // 4.1 ReLU - VECTOR VERSION
     relu_int32_vec(fc1_out, fc1_out_features);
+    ROI_END(3);
+    hpm_report("fc1", &layer);
 
     // ------------------------------------------
     // Layer 5: Fully Connected 2
@@ -126,6 +142,8 @@ int main() {
     // Input: 60. Output: 10.
     // Weight shape: [60, 10] (Transposed)
     printf("4. Executing FC2 (Vector)...\n");
+    hpm_snapshot(&layer);
+    ROI_BEGIN(4);
     
     int fc2_in_features = 60;
     int fc2_out_features = 10;
@@ -143,6 +161,8 @@ int main() {
 
     // Bias Add - VECTOR VERSION
     matadd_int32_vec(fc2_out, (int32_t*)ADDR_BFC2, fc2_out, fc2_out_features);
+    ROI_END(4);
+    hpm_report("fc2", &layer);
 
     printf("\n=== FC2 Output (pre-Softmax) - VECTOR ===\n");
     for (int i = 0; i < fc2_out_features; i++) {
@@ -153,7 +173,11 @@ int main() {
     // Layer 6: Softmax
     // ------------------------------------------
     printf("5. Executing Softmax (Vector)...\n");
+    hpm_snapshot(&layer);
+    ROI_BEGIN(5);
     softmax_hw_vec(fc2_out, softmax_out, (int32_t*)ADDR_SOFTMAX_LUT, fc2_out_features);
+    ROI_END(5);
+    hpm_report("softmax", &layer);
 
     // ------------------------------------------
     // 结果打印
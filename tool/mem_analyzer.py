@@ -0,0 +1,213 @@
+import argparse
+import bisect
+import gzip
+import re
+import struct
+from collections import Counter, defaultdict
+
+# Offline analyzer for the memory access trace written by `emu --mem-trace`
+# (see hw/csrc/memtrace/memtrace.h): a gzip stream of the magic "EMUMTRC1"
+# followed by 24-byte records
+#   cycle (u64), pc (u32), addr (u32), size (u16), flags (u8), padding
+# with pc and addr relative to 0x80000000.
+#
+# Reports per function: accesses, bytes, bytes per instruction (given the
+# --profile output of the same run), the dominant strides of its memory
+# instructions and the reuse distance of the cache lines it touches, plus
+# alignment histograms for the whole run.
+#
+#   python mem_analyzer.py mem.trace.gz --disasm ../sw/build/vec_op_nn_test-riscv64-mycpu.txt \
+#       [--profile profile.txt] [--line 64] [--max-records N]
+
+ADDR_BASE = int( "0x80000000", 16 )
+
+MEMTRACE_MAGIC = b"EMUMTRC1"
+RECORD = struct.Struct("<QIIHB5x")
+
+FLAG_WRITE  = 0x1
+FLAG_VECTOR = 0x2
+
+# reuse distance buckets, in distinct cache lines touched in between
+REUSE_BUCKETS = [ (16, "<16"), (256, "<256"), (4096, "<4K"), (65536, "<64K"), (None, ">=64K") ]
+
+def read_trace(path, max_records=None):
+    with gzip.open(path, "rb") as f:
+        assert f.read(8) == MEMTRACE_MAGIC, "%s is not a memory trace" % path
+        n = 0
+        while max_records is None or n < max_records:
+            chunk = f.read(RECORD.size * 4096)
+            if not chunk:
+                break
+            for rec in RECORD.iter_unpack(chunk[:len(chunk) - len(chunk) % RECORD.size]):
+                yield rec
+                n += 1
+                if max_records is not None and n >= max_records:
+                    break
+
+def load_symbols(disasm):
+    # "0000000080000000 <_start>:" lines of the objdump -d output
+    pattern = re.compile(r"^([0-9a-f]+) <(.+)>:$")
+    symbols = []
+    with open(disasm) as f:
+        for line in f:
+            m = pattern.match(line.strip())
+            if m:
+                symbols.append((int(m.group(1), 16), m.group(2)))
+    symbols.sort()
+    return [s[0] for s in symbols], [s[1] for s in symbols]
+
+def load_profile(path):
+    # self cycles per function from the flat part of `emu --profile`
+    pattern = re.compile(r"^\s*[0-9.]+%\s+(\d+)\s+\S+\s+\S+\s+(\S+)$")
+    cycles = {}
+    with open(path) as f:
+        for line in f:
+            if line.startswith("Call-site"):
+                break
+            m = pattern.match(line)
+            if m:
+                cycles[m.group(2)] = int(m.group(1))
+    return cycles
+
+class Fenwick:
+    def __init__(self, n):
+        self.n = n
+        self.tree = [0] * (n + 1)
+
+    def add(self, i, v):
+        i += 1
+        while i <= self.n:
+            self.tree[i] += v
+            i += i & -i
+
+    def prefix(self, i):
+        # sum of [0, i)
+        s = 0
+        while i > 0:
+            s += self.tree[i]
+            i -= i & -i
+        return s
+
+def reuse_bucket(dist):
+    if dist is None:
+        return "cold"
+    for limit, name in REUSE_BUCKETS:
+        if limit is None or dist < limit:
+            return name
+
+class FuncStats:
+    def __init__(self):
+        self.reads = 0
+        self.writes = 0
+        self.vector = 0
+        self.bytes = 0
+        self.strides = Counter()
+        self.reuse = Counter()
+
+def analyze(args):
+    if args.disasm:
+        sym_addr, sym_name = load_symbols(args.disasm)
+    else:
+        sym_addr, sym_name = [], []
+
+    def symbolize(pc):
+        i = bisect.bisect_right(sym_addr, pc) - 1
+        return sym_name[i] if i >= 0 else "0x%x" % pc
+
+    records = list(read_trace(args.trace, args.max_records))
+    print("Records: %d" % len(records))
+    if not records:
+        return
+
+    funcs = defaultdict(FuncStats)
+    last_addr_of_pc = {}
+    func_of_pc = {}
+    align_scalar = defaultdict(Counter)
+    align_vector = Counter()
+
+    # reuse distance at cache line granularity: for every access, the number
+    # of distinct lines touched since the previous access to the same line
+    fenwick = Fenwick(len(records))
+    last_use = {}
+    reuse_all = Counter()
+
+    for i, (cycle, pc, addr, size, flags) in enumerate(records):
+        pc += ADDR_BASE
+        addr += ADDR_BASE
+        name = func_of_pc.get(pc)
+        if name is None:
+            name = func_of_pc[pc] = symbolize(pc)
+        f = funcs[name]
+        if flags & FLAG_WRITE:
+            f.writes += 1
+        else:
+            f.reads += 1
+        if flags & FLAG_VECTOR:
+            f.vector += 1
+            align_vector[addr % 64] += 1
+        else:
+            align_scalar[size][addr % 8] += 1
+        f.bytes += size
+
+        prev = last_addr_of_pc.get(pc)
+        if prev is not None:
+            f.strides[addr - prev] += 1
+        last_addr_of_pc[pc] = addr
+
+        line = addr // args.line
+        prev_use = last_use.get(line)
+        if prev_use is None:
+            dist = None
+        else:
+            dist = fenwick.prefix(i) - fenwick.prefix(prev_use + 1)
+            fenwick.add(prev_use, -1)
+        fenwick.add(i, 1)
+        last_use[line] = i
+        bucket = reuse_bucket(dist)
+        f.reuse[bucket] += 1
+        reuse_all[bucket] += 1
+
+    profile = load_profile(args.profile) if args.profile else {}
+    total = len(records)
+
+    print("")
+    print("Per-function accesses (sorted by bytes):")
+    print("%-36s %10s %10s %8s %12s %8s %8s  %s" % ("function", "reads", "writes", "vector%",
+          "bytes", "B/access", "B/inst", "top strides (count%)"))
+    for name, f in sorted(funcs.items(), key=lambda kv: -kv[1].bytes):
+        n = f.reads + f.writes
+        strides = sum(f.strides.values())
+        top = ", ".join("%+d (%.0f%%)" % (s, 100.0 * c / strides) for s, c in f.strides.most_common(3))
+        insts = profile.get(name)
+        per_inst = "%8.2f" % (f.bytes / insts) if insts else "%8s" % "-"
+        print("%-36s %10d %10d %7.1f%% %12d %8.2f %s  %s" % (name[:36], f.reads, f.writes,
+              100.0 * f.vector / n, f.bytes, f.bytes / n, per_inst, top))
+
+    names = ["cold"] + [b[1] for b in REUSE_BUCKETS]
+    print("")
+    print("Reuse distance in %d-byte lines (distinct lines touched in between):" % args.line)
+    print("%-36s " % "function" + " ".join("%8s" % b for b in names))
+    print("%-36s " % "all" + " ".join("%7.1f%%" % (100.0 * reuse_all[b] / total) for b in names))
+    for name, f in sorted(funcs.items(), key=lambda kv: -kv[1].bytes):
+        n = f.reads + f.writes
+        print("%-36s " % name[:36] + " ".join("%7.1f%%" % (100.0 * f.reuse[b] / n) for b in names))
+
+    print("")
+    print("Alignment of scalar accesses (address % 8, reads are word granular):")
+    for size in sorted(align_scalar):
+        hist = align_scalar[size]
+        n = sum(hist.values())
+        print("  size %d: " % size + " ".join("%d:%.1f%%" % (o, 100.0 * c / n) for o, c in sorted(hist.items())))
+    if align_vector:
+        n = sum(align_vector.values())
+        print("Alignment of vector accesses (address % 64):")
+        print("  " + " ".join("%d:%.1f%%" % (o, 100.0 * c / n) for o, c in sorted(align_vector.items())))
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Analyze an emu --mem-trace file")
+    parser.add_argument("trace", help="trace written by emu --mem-trace")
+    parser.add_argument("--disasm", help="objdump -d output of the program (sw/build/*.txt)")
+    parser.add_argument("--profile", help="emu --profile output of the same run, for bytes per instruction")
+    parser.add_argument("--line", type=int, default=64, help="cache line size for the reuse distance")
+    parser.add_argument("--max-records", type=int, default=None, help="only analyze the first N records")
+    analyze(parser.parse_args())
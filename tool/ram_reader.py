@@ -14,7 +14,37 @@ def parse_addr(addr):
         assert False, "The type of addr is incorrect !!!"
     return t_addr 
 
+# sparse save container written by the emulator (see save_data in ram.cpp):
+# magic, base address, flat size, number of ranges, then per range
+# address, length and the data. Bytes outside the ranges read as zero.
+SPARSE_MAGIC = b"EMUSPRS1"
+
+def load_sparse(img):
+    with open( img, "rb" ) as f:
+        if f.read(8) != SPARSE_MAGIC:
+            return None
+        base, size, nr = struct.unpack("<QQQ", f.read(24))
+        ranges = []
+        for i in range(nr):
+            r_addr, r_len = struct.unpack("<QQ", f.read(16))
+            ranges.append((r_addr, f.read(r_len)))
+    return ranges
+
+def read_sparse(ranges, addr, size):
+    data = bytearray(size)
+    for r_addr, r_data in ranges:
+        lo = max(addr, r_addr)
+        hi = min(addr+size, r_addr+len(r_data))
+        if lo < hi:
+            data[lo-addr:hi-addr] = r_data[lo-r_addr:hi-r_addr]
+    return bytes(data)
+
 def read_img(img, addr, length=1, size=1, addr_start="0x80800000"):
+    ranges = load_sparse(img)
+    if ranges is not None:
+        addr = parse_addr(addr)
+        return [read_sparse(ranges, addr+i*size, size) for i in range(length)]
+
     addr = parse_addr(addr) - ADDR_BASE
     addr_s = parse_addr(addr_start) - ADDR_BASE
     offset = addr-addr_s